@@ -0,0 +1,104 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "rmw/event.h"
+#include "rmw/rmw.h"
+
+#ifndef RMW_HAZCAT__HAZCAT_EVENT_H_
+#define RMW_HAZCAT__HAZCAT_EVENT_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Deadline and liveliness events are driven by an event_timer_t in the publisher or subscription
+// they're for, which is stored in rmw_event_t::data, and kept in the entity's info rather than the
+// event since rmw has no hook to free event data. Each timer's timerfd is created when the first
+// event of its type is initialized, and armed for the moment the event's condition could next
+// change. rmw_wait registers it with the wait set's epoll instance like any other fd, and when it
+// fires, hazcat_event_check updates the event's status and re-arms it. Nothing polls in between.
+//
+// Deadlines are counted from the first message published, or taken, onwards. A subscription's
+// messages count as they arrive if they haven't been taken by the time the timer fires. Every
+// whole deadline that passes without one counts as missed.
+//
+// Only MANUAL_BY_TOPIC publishers with a lease can lose their liveliness, since the others are
+// alive as long as their process is. Their last assertion, by publishing or by
+// rmw_publisher_assert_liveliness, is kept in their endpoint in the ROS graph, where subscriptions
+// in any process see it. A subscription's LIVELINESS_CHANGED timer is only armed for the earliest
+// lease of a publisher on the topic to run out. Publishers that come, go, or come back to life
+// change the graph instead, whose watcher fires the timer (see hazcat_ros_graph.h). Publishers of
+// a process that died without destroying them are counted as not alive once the graph next changes.
+//
+// RMW_EVENT_MESSAGE_LOST has no timer. It stores the subscription it's for in rmw_event_t::data,
+// and losses are found as a side effect of taking messages from it (see hazcat_subscription.h),
+// so rmw_wait just checks it before blocking.
+
+typedef struct hazcat_event_timer
+{
+  int fd;                         // timerfd, -1 until an event of this type is initialized
+  rmw_event_type_t type;          // Deadline or liveliness event this timer drives
+  const void * entity;            // rmw_publisher_t or rmw_subscription_t it belongs to
+  int64_t period;                 // Deadline or lease in nanoseconds, 0 if the policy is off
+  int64_t start;                  // Last message or assertion, 0 if none yet (accessed atomically)
+  int32_t count;                  // Deadlines missed or times liveliness was lost (atomic)
+  int32_t alive;                  // Publisher alive, or number of live publishers matched (atomic)
+  int32_t not_alive;              // Number of matched publishers that aren't alive (atomic)
+  int32_t count_reported;         // Values of the above as of the last event taken (atomic)
+  int32_t alive_reported;
+  int32_t not_alive_reported;
+} event_timer_t;
+
+// Nanoseconds in a deadline or lease duration, 0 if it's unspecified or infinite
+int64_t
+hazcat_duration_ns(rmw_time_t duration);
+
+// CLOCK_MONOTONIC in nanoseconds, which every event timer runs on
+int64_t
+hazcat_monotonic_now(void);
+
+// Prepare timer to drive events of the given type for entity. The policy is off if period is 0
+void
+hazcat_event_timer_init(
+  event_timer_t * timer, rmw_event_type_t type, const void * entity, int64_t period);
+
+void
+hazcat_event_timer_fini(event_timer_t * timer);
+
+// Record a message published or taken, or a liveliness assertion, at now. Costs an atomic store,
+// except for the first one after the timer was started or liveliness was lost
+void
+hazcat_event_timer_restart(event_timer_t * timer, int64_t now);
+
+// Bring the status of timer's events up to date, and re-arm it. Called when its fd fires
+void
+hazcat_event_check(event_timer_t * timer);
+
+// Timer behind event, or NULL if it has none
+event_timer_t *
+hazcat_event_timer(const rmw_event_t * event);
+
+// Whether taking event would report anything new
+bool
+hazcat_event_is_ready(const rmw_event_t * event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_HAZCAT__HAZCAT_EVENT_H_
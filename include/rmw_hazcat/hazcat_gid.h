@@ -0,0 +1,51 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "rmw/rmw.h"
+
+#ifndef RMW_HAZCAT__HAZCAT_GID_H_
+#define RMW_HAZCAT__HAZCAT_GID_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// How rmw_hazcat lays out rmw_gid_t::data. Entities are unique across hosts and reboots (host),
+// processes (pid, and nonce for pid reuse and pid namespaces sharing /dev/shm), and within a
+// process (count). The rest of data is zero
+typedef struct hazcat_gid
+{
+  uint32_t host;                  // Hash of the boot id
+  uint32_t pid;                   // Process that created the entity
+  uint32_t nonce;                 // Random, drawn once per process
+  uint32_t count;                 // Entities created by the process before this one
+} gid_layout_t;
+
+// A new gid, never returned before by any process on any host (short of 64 bits colliding)
+rmw_gid_t
+hazcat_generate_gid(void);
+
+// Whether gid was generated by this process
+bool
+hazcat_gid_is_local(const gid_layout_t * gid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_HAZCAT__HAZCAT_GID_H_
@@ -0,0 +1,45 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#ifndef RMW_HAZCAT__HAZCAT_GUARD_CONDITION_H_
+#define RMW_HAZCAT__HAZCAT_GUARD_CONDITION_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Stored in rmw_guard_condition_t::data. The eventfd counts triggers, so triggering is a single
+// 8 byte write, and a single read both resets it and returns how many times it was triggered.
+// pending mirrors it in memory, so a spinning rmw_wait can notice a trigger without a syscall.
+typedef struct hazcat_guard_condition_info
+{
+  int fd;                         // eventfd, readable while triggered
+  uint32_t pending;               // Nonzero if triggered since last taken (accessed atomically)
+} guard_condition_info_t;
+
+// Number of times gc was triggered since the last call, and reset it
+uint64_t
+hazcat_guard_condition_take(guard_condition_info_t * gc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_HAZCAT__HAZCAT_GUARD_CONDITION_H_
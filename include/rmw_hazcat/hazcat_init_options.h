@@ -0,0 +1,44 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#ifndef RMW_HAZCAT__HAZCAT_INIT_OPTIONS_H_
+#define RMW_HAZCAT__HAZCAT_INIT_OPTIONS_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Stored in rmw_init_options_t::impl, which stays NULL until one of these options is changed
+// from its default
+typedef struct hazcat_init_options
+{
+  uint64_t wait_spin_ns;          // Default spin budget for wait sets, see hazcat_wait_set.h
+} init_options_impl_t;
+
+// Make every wait set created in a context initialized with these options spin for up to spin_ns
+// nanoseconds before blocking. 0, the default, blocks right away
+rmw_ret_t
+rmw_hazcat_init_options_set_wait_spin(rmw_init_options_t * init_options, uint64_t spin_ns);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_HAZCAT__HAZCAT_INIT_OPTIONS_H_
@@ -0,0 +1,170 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <time.h>
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rosidl_typesupport_introspection_c/message_introspection.h"
+
+#include "rmw_hazcat/hazcat_gid.h"
+
+#ifndef RMW_HAZCAT__HAZCAT_MESSAGE_H_
+#define RMW_HAZCAT__HAZCAT_MESSAGE_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Room given to strings and sequences in each block of an rmw-created allocator when the message
+// type has unbounded ones. Publishers move to larger blocks when a message needs more
+#define HAZCAT_DEFAULT_PAYLOAD_SIZE 4096
+
+// Every block a publisher enqueues starts with this header, followed by the message. Message
+// pointers, including loaned ones, point past it. hazcat copies it along with the message into
+// other domains, so a subscriber finds it in front of whatever message it takes
+typedef struct hazcat_message_header
+{
+  int64_t source_timestamp;       // System time when published, in nanoseconds
+  uint64_t sequence_number;       // 1 for the publisher's first message, and counting
+  gid_layout_t publisher_gid;     // Publisher that published it
+} message_header_t;
+
+// Room left for message_header_t in front of every message. A multiple of 16, so messages stay as
+// aligned as the blocks holding them
+#define HAZCAT_MESSAGE_HEADER_SIZE 32
+
+static inline message_header_t *
+hazcat_message_header(const void * msg)
+{
+  return (message_header_t *)((uint8_t *)msg - HAZCAT_MESSAGE_HEADER_SIZE);
+}
+
+// System time in nanoseconds. glibc reads CLOCK_REALTIME through the vDSO, so this stays out of
+// the kernel
+static inline int64_t
+hazcat_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Every string and sequence type in the C typesupport shares this layout
+typedef struct hazcat_sequence
+{
+  void * data;
+  size_t size;
+  size_t capacity;
+} sequence_t;
+
+// A sequence, bounded or not, as opposed to a single value or a fixed size array
+static inline bool
+hazcat_member_is_sequence(const rosidl_typesupport_introspection_c__MessageMember * member)
+{
+  return member->is_array_ && (0 == member->array_size_ || member->is_upper_bound_);
+}
+
+// Size of one element of member, as laid out in the message struct or a sequence buffer
+size_t
+hazcat_member_element_size(const rosidl_typesupport_introspection_c__MessageMember * member);
+
+// Introspection members of a message type, or NULL if it's only available through the C++
+// typesupport. Without C introspection there's nothing to pack a message with, so publishers and
+// subscriptions only accept such types if they're flat
+const rosidl_typesupport_introspection_c__MessageMembers *
+hazcat_message_members(const rosidl_message_type_support_t * type_support);
+
+// Number of bytes ros_message occupies once its strings and sequences are packed in behind it
+size_t
+hazcat_message_size(
+  const rosidl_typesupport_introspection_c__MessageMembers * members,
+  const void * ros_message);
+
+// Most bytes a message of type members can occupy once packed, or 0 if it has unbounded strings or
+// sequences
+size_t
+hazcat_message_max_size(const rosidl_typesupport_introspection_c__MessageMembers * members);
+
+// Size of the blocks rmw_hazcat gives a message of type members, header included. msg_size is the
+// size of the message struct. Types with unbounded strings or sequences get
+// HAZCAT_DEFAULT_PAYLOAD_SIZE bytes for them to start with
+size_t
+hazcat_message_block_size(
+  const rosidl_typesupport_introspection_c__MessageMembers * members, bool is_flat,
+  size_t msg_size);
+
+// Copy ros_message into block, which must be at least hazcat_message_size() bytes. Strings and
+// sequences are appended after the message struct, and their data pointers are replaced by their
+// offset from the start of block, so the result is valid in any process that maps it.
+void
+hazcat_message_pack(
+  const rosidl_typesupport_introspection_c__MessageMembers * members,
+  const void * ros_message,
+  void * block);
+
+// Copy a block written by hazcat_message_pack into ros_message, which must already be initialized.
+// Its strings and sequences are resized to fit.
+rmw_ret_t
+hazcat_message_unpack(
+  const rosidl_typesupport_introspection_c__MessageMembers * members,
+  const void * block,
+  void * ros_message);
+
+// Stored in rmw_publisher_allocation_t::data and rmw_subscription_allocation_t::data. Holds an
+// initialized message of the type the allocation was made for, so publishing or taking serialized
+// messages with strings or sequences can decode or encode through it instead of creating and
+// destroying a message on every call. Its strings and sequences keep whatever storage they grew to
+// between calls. Only one publish or take may use an allocation at a time
+typedef struct hazcat_allocation
+{
+  const rosidl_typesupport_introspection_c__MessageMembers * members;   // NULL if C++ only
+  void * scratch;                 // Initialized message of type members, NULL if flat or C++ only
+} allocation_info_t;
+
+// Create allocation data for type_support. Flat and C++ only types need no scratch message
+rmw_ret_t
+hazcat_allocation_init(
+  const rosidl_message_type_support_t * type_support,
+  allocation_info_t ** allocation);
+
+void
+hazcat_allocation_fini(allocation_info_t * allocation);
+
+// Return RMW_RET_INCORRECT_RMW_IMPLEMENTATION from the calling function if allocation, a publisher
+// or subscription allocation that may be NULL, was made by another rmw implementation
+#define HAZCAT_CHECK_ALLOCATION(allocation) \
+  do { \
+    if (NULL != (allocation) && \
+      (allocation)->implementation_identifier != rmw_get_implementation_identifier()) \
+    { \
+      return RMW_RET_INCORRECT_RMW_IMPLEMENTATION; \
+    } \
+  } while (0)
+
+// Scratch message in allocation for messages of type members, or NULL if allocation is NULL, has
+// none, or was made for another type
+void *
+hazcat_allocation_scratch(
+  const allocation_info_t * allocation,
+  const rosidl_typesupport_introspection_c__MessageMembers * members);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_HAZCAT__HAZCAT_MESSAGE_H_
@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <stdint.h>
+
 #include "rmw/error_handling.h"
 #include "rmw/rmw.h"
 
@@ -26,12 +28,14 @@ extern "C"
 typedef struct hazcat_node_info
 {
   rmw_guard_condition_t * const guard_condition_;   // Triggers whenver ros graph changes
+  int32_t graph_slot;             // Slot in the ROS graph, see hazcat_ros_graph.h
 } node_info_t;
 
 // Bytewise identical with above but with const keywords removed for one time assignment
 typedef struct hazcat_node_info__
 {
   rmw_guard_condition_t * guard_condition;
+  int32_t graph_slot;
 } construct_node_info__;
 
 #ifdef __cplusplus
@@ -0,0 +1,93 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rosidl_typesupport_introspection_c/message_introspection.h"
+
+#include "hazcat/types.h"
+
+#include "rmw_hazcat/hazcat_event.h"
+#include "rmw_hazcat/hazcat_typesupport.h"
+
+#ifndef RMW_HAZCAT__HAZCAT_PUBLISHER_H_
+#define RMW_HAZCAT__HAZCAT_PUBLISHER_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Stored in rmw_publisher_t::data. The hazcat message queue only knows about the leading
+// pub_sub_data_t, so a publisher_info_t pointer can be passed anywhere a pub_data_t is expected.
+//
+// Messages with strings or sequences are packed into a single block (see hazcat_message.h) and
+// can't be loaned, since their layout in shared memory differs from the one the user expects.
+// Packing needs the C introspection typesupport, so C++ types with strings or sequences are
+// refused when the publisher is created.
+//
+// rmw_publish leaves the message with its caller, so it always copies it into a block of its own.
+// Messages borrowed with rmw_borrow_loaned_message are already in the publisher's allocator, and
+// rmw_publish_loaned_message enqueues them without a copy.
+//
+// Each block starts with a message_header_t (see hazcat_message.h), stamped as it's published.
+// data.msg_size counts it, so allocators passed in rmw_specific_publisher_payload need blocks
+// HAZCAT_MESSAGE_HEADER_SIZE bytes larger than the message, plus room for whatever strings and
+// sequences get packed in behind it. Allocators created by rmw_hazcat have block_size bytes per
+// block, enough for any message of the type if its strings and sequences are bounded (see
+// hazcat_message_block_size). A message that doesn't fit moves the publisher to a new allocator
+// with blocks at least twice as large. alloc_lock keeps that from happening while another thread
+// is between allocating a block and enqueueing it.
+//
+// While the topic has no subscribers, in any process, publishing does nothing but count the
+// message in skipped. Loaned messages published meanwhile are returned to the allocator.
+//
+// Publishing, skipped or not, counts toward the deadline and asserts liveliness (see
+// hazcat_event.h). Neither costs more than an atomic store unless the policy is on.
+typedef struct hazcat_publisher_info
+{
+  pub_sub_data_t data;            // Must be first
+  const type_info_t * type;       // Message type, as resolved by hazcat_type_info
+  const rosidl_typesupport_introspection_c__MessageMembers * members;   // NULL if C++ only
+  bool is_flat;                   // No strings or sequences, message can be memcpy'd
+  size_t block_size;              // Bytes per block, header included, 0 if alloc isn't ours
+  pthread_rwlock_t alloc_lock;    // Held for writing while data.alloc is replaced
+  uint64_t sequence_number;       // Messages published so far (accessed atomically)
+  uint64_t skipped;               // Messages dropped for lack of subscribers (accessed atomically)
+  int32_t graph_slot;             // Slot in the ROS graph, see hazcat_ros_graph.h
+  rmw_qos_profile_t qos;          // As requested when the publisher was created
+  event_timer_t deadline;         // Drives RMW_EVENT_OFFERED_DEADLINE_MISSED
+  event_timer_t liveliness;       // Drives RMW_EVENT_LIVELINESS_LOST
+} publisher_info_t;
+
+// Like rmw_publish, but stamps the message with sequence_number instead of the publisher's next
+// one. Services use it to tag each response with the sequence number of its request
+rmw_ret_t
+hazcat_publisher_publish(
+  const rmw_publisher_t * publisher,
+  const void * ros_message,
+  uint64_t sequence_number);
+
+// Number of messages publisher has dropped because nobody subscribed to its topic
+rmw_ret_t
+hazcat_publisher_get_skipped_count(const rmw_publisher_t * publisher, uint64_t * count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_HAZCAT__HAZCAT_PUBLISHER_H_
@@ -0,0 +1,229 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "rcutils/types.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/names_and_types.h"
+#include "rmw/rmw.h"
+#include "rmw/topic_endpoint_info_array.h"
+
+#ifndef RMW_HAZCAT__HAZCAT_ROS_GRAPH_H_
+#define RMW_HAZCAT__HAZCAT_ROS_GRAPH_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Name of the graph's shared memory file, /dev/shm/hazcat_graph
+#define HAZCAT_GRAPH_FILE "/hazcat_graph"
+
+// Longest node name, namespace, enclave, topic name or type name kept, terminator included
+#define HAZCAT_GRAPH_NAME_MAX 256
+
+#define HAZCAT_GRAPH_MAX_NODES 1024
+#define HAZCAT_GRAPH_MAX_TOPICS 4096
+#define HAZCAT_GRAPH_MAX_ENDPOINTS 16384
+
+// Length of topic_index[], a power of 2 twice HAZCAT_GRAPH_MAX_TOPICS, so probes stay short
+#define HAZCAT_GRAPH_TOPIC_BUCKETS 8192
+
+// Bit values, so queries can ask for either or both
+typedef enum hazcat_graph_endpoint_kind
+{
+  GRAPH_PUBLISHER = 1,
+  GRAPH_SUBSCRIPTION = 2
+} graph_endpoint_kind_t;
+
+// A process, as told apart across PID namespaces. pid only means something in the PID namespace
+// pid_ns, so processes in other namespaces, such as other containers sharing /dev/shm, can't be
+// checked on and are assumed to be alive. boot_id tells processes of an earlier boot apart
+typedef struct hazcat_graph_process
+{
+  int32_t pid;                    // 0 if the slot holding this is free
+  uint32_t boot_id;               // Hash of /proc/sys/kernel/random/boot_id
+  uint64_t pid_ns;                // Inode of /proc/self/ns/pid
+} graph_process_t;
+
+typedef struct hazcat_graph_node
+{
+  graph_process_t process;        // Process the node lives in, pid 0 if the slot is free
+  int32_t next_free;              // Next free slot while free, -1 ends the list
+  char name[HAZCAT_GRAPH_NAME_MAX];
+  char namespace_[HAZCAT_GRAPH_NAME_MAX];
+  char enclave[HAZCAT_GRAPH_NAME_MAX];
+} graph_node_t;
+
+typedef struct hazcat_graph_topic
+{
+  int32_t first;                  // First endpoint on the topic, or next free slot while free
+  uint32_t publisher_count;       // Publishers on the topic, 0 if the slot is free
+  uint32_t subscription_count;    // Subscriptions on the topic, 0 if the slot is free
+  char name[HAZCAT_GRAPH_NAME_MAX];
+} graph_topic_t;
+
+typedef struct hazcat_graph_endpoint
+{
+  graph_process_t process;        // Process the endpoint lives in, pid 0 if the slot is free
+  graph_endpoint_kind_t kind;
+  int32_t node;                   // Slot of the node it belongs to
+  int32_t topic;                  // Slot of its topic
+  int32_t next;                   // Next endpoint on the same topic, or next free slot. -1 ends
+  uint8_t gid[RMW_GID_STORAGE_SIZE];
+  rmw_qos_profile_t qos;          // As requested when the endpoint was created
+  int64_t asserted;               // Last liveliness assertion, CLOCK_MONOTONIC ns (atomic)
+  char type[HAZCAT_GRAPH_NAME_MAX];
+} graph_endpoint_t;
+
+// The ROS graph of every process on the host, mapped by each of them from HAZCAT_GRAPH_FILE. Nodes,
+// topics and endpoints each live in a table of slots, with free slots chained into a list and
+// only the first *_high slots ever used, so a scan stops there. Each endpoint is chained into the
+// list of its topic, and topics are found by name through topic_index[], open addressing keyed by
+// a hash of the name. Counts and per-topic lookups touch only the topic's slot and its endpoints.
+//
+// Writers serialize on lock, a robust process-shared mutex, so a process dying in the middle of
+// an update doesn't block everyone else. Each update makes seq odd while it's in progress and even
+// again after. Readers copy what they need, then start over if seq changed in the meantime, and
+// only take the lock to wait out an update they find in progress. A torn read can see any garbage,
+// so readers bound every index and loop before following it.
+//
+// Entities of processes that died without destroying them are swept out by the next process to
+// map the graph from the same PID namespace.
+//
+// generation is bumped after every update, and doubles as a futex that every update wakes. A
+// thread in each process with nodes sleeps on it, and triggers the graph guard conditions of that
+// process's nodes, and the liveliness timers of its subscriptions, when it changes, so they fire
+// for changes made anywhere on the host. A publisher asserting its liveliness after its lease ran
+// out bumps it too.
+typedef struct hazcat_graph
+{
+  uint32_t magic;                 // HAZCAT_GRAPH_MAGIC once initialized (accessed atomically)
+  uint32_t seq;                   // Odd while an update is in progress (accessed atomically)
+  uint32_t generation;            // Updates so far, and a futex (accessed atomically)
+  pthread_mutex_t lock;           // Held by writers
+  int32_t node_high;              // Slots of nodes[] ever used
+  int32_t node_free;              // First free slot below node_high, -1 if none
+  int32_t topic_high;
+  int32_t topic_free;
+  int32_t topic_tombstones;       // Buckets of topic_index[] left behind by removed topics
+  int32_t endpoint_high;
+  int32_t endpoint_free;
+  int32_t topic_index[HAZCAT_GRAPH_TOPIC_BUCKETS];   // Topic slot, -1 if empty, -2 if removed
+  graph_node_t nodes[HAZCAT_GRAPH_MAX_NODES];
+  graph_topic_t topics[HAZCAT_GRAPH_MAX_TOPICS];
+  graph_endpoint_t endpoints[HAZCAT_GRAPH_MAX_ENDPOINTS];
+} graph_t;
+
+// The graph, mapped and swept the first time it's asked for
+rmw_ret_t
+hazcat_graph_attach(graph_t ** graph);
+
+// Record node in the graph, returning the slot it's given
+rmw_ret_t
+hazcat_graph_add_node(const rmw_node_t * node, int32_t * slot);
+
+rmw_ret_t
+hazcat_graph_remove_node(int32_t slot);
+
+// Trigger guard_condition whenever the graph changes, until hazcat_graph_unwatch returns
+rmw_ret_t
+hazcat_graph_watch(const rmw_guard_condition_t * guard_condition);
+
+void
+hazcat_graph_unwatch(const rmw_guard_condition_t * guard_condition);
+
+// Make the timerfd fd fire whenever the graph changes, until hazcat_graph_unwatch_timer returns
+rmw_ret_t
+hazcat_graph_watch_timer(int fd);
+
+void
+hazcat_graph_unwatch_timer(int fd);
+
+// Record an endpoint of the node in node_slot on topic_name, returning the slot it's given
+rmw_ret_t
+hazcat_graph_add_endpoint(
+  int32_t node_slot,
+  graph_endpoint_kind_t kind,
+  const char * topic_name,
+  const char * type_name,
+  const rmw_gid_t * gid,
+  const rmw_qos_profile_t * qos,
+  int32_t * slot);
+
+rmw_ret_t
+hazcat_graph_remove_endpoint(int32_t slot);
+
+// Number of publishers and subscriptions on topic_name, either of which may be NULL. Only looks at
+// the topic's slot
+rmw_ret_t
+hazcat_graph_count(const char * topic_name, size_t * publishers, size_t * subscriptions);
+
+// Node, type, GID and QoS of every endpoint of the given kind on topic_name, which must be zero
+// initialized. Only walks the topic's own endpoints
+rmw_ret_t
+hazcat_graph_get_endpoint_info(
+  const char * topic_name,
+  graph_endpoint_kind_t kind,
+  rcutils_allocator_t * allocator,
+  rmw_topic_endpoint_info_array_t * endpoints_info);
+
+// Record a liveliness assertion of the publisher in slot at now. Lock free, a single atomic
+// exchange, unless the publisher's lease had run out and the graph's watchers need waking
+void
+hazcat_graph_assert_liveliness(int32_t slot, int64_t now);
+
+// Number of publishers on topic_name that are alive at now, and that aren't. A publisher is alive
+// while its process is, and, if its liveliness is MANUAL_BY_TOPIC with a lease, while its last
+// assertion is younger than the lease. next_expiry is set to the earliest time one of them stops
+// being alive by lease, or 0 if none can
+rmw_ret_t
+hazcat_graph_count_alive(
+  const char * topic_name,
+  int64_t now,
+  int32_t * alive,
+  int32_t * not_alive,
+  int64_t * next_expiry);
+
+// Names, namespaces and, unless NULL, enclaves of every node in the graph. The arrays must be
+// zero initialized
+rmw_ret_t
+hazcat_graph_get_node_names(
+  rcutils_string_array_t * node_names,
+  rcutils_string_array_t * node_namespaces,
+  rcutils_string_array_t * enclaves);
+
+// Names and types of the topics that have endpoints of the given kinds, sorted by name. With
+// services set, the services that have servers (GRAPH_SUBSCRIPTION) or clients (GRAPH_PUBLISHER)
+// instead. With node_name set, only endpoints of that node count, and there must be such a node.
+// no_demangle lists every topic under its hazcat name, internal ones included
+rmw_ret_t
+hazcat_graph_get_names_and_types(
+  const char * node_name,
+  const char * node_namespace,
+  uint32_t kinds,
+  bool services,
+  bool no_demangle,
+  rcutils_allocator_t * allocator,
+  rmw_names_and_types_t * names_and_types);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_HAZCAT__HAZCAT_ROS_GRAPH_H_
@@ -0,0 +1,51 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_hazcat/hazcat_typesupport.h"
+
+#ifndef RMW_HAZCAT__HAZCAT_SERIALIZE_H_
+#define RMW_HAZCAT__HAZCAT_SERIALIZE_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Encode ros_message as CDR into serialized_message, growing its buffer as needed. Works on any
+// message of the C or C++ type described by type, including a flat message sitting in shared
+// memory. The first call for a type builds a serialization plan for it, which later calls reuse.
+// rmw_serialize is this, after looking up the type.
+rmw_ret_t
+hazcat_serialize(
+  const type_info_t * type,
+  const void * ros_message,
+  rmw_serialized_message_t * serialized_message);
+
+// Decode serialized_message into ros_message, which must already be initialized. A flat message
+// can be decoded straight into a block of shared memory. rmw_deserialize is this, after looking
+// up the type.
+rmw_ret_t
+hazcat_deserialize(
+  const type_info_t * type,
+  const rmw_serialized_message_t * serialized_message,
+  void * ros_message);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_HAZCAT__HAZCAT_SERIALIZE_H_
@@ -0,0 +1,86 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_hazcat/hazcat_gid.h"
+
+#ifndef RMW_HAZCAT__HAZCAT_SERVICE_H_
+#define RMW_HAZCAT__HAZCAT_SERVICE_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Services run on the same message queues as topics. A service subscribes to its request topic,
+// which every client of it publishes to. Each client subscribes to a response topic of its own,
+// named after the gid of its request publisher, which the service publishes to when it responds.
+// Both topics are private to rmw_hazcat, and named so they can't clash with a ROS topic.
+//
+// A request's id is the gid of the client's request publisher and the sequence number in its
+// header. The response carries the same sequence number in its header, so the client can tell
+// which request it answers.
+//
+// A service's publisher on a client's response topic is destroyed once the client is, the next
+// time the service answers a client it has no publisher for.
+
+// One response topic the service has published to
+typedef struct hazcat_responder
+{
+  gid_layout_t client;            // Request publisher of the client it answers
+  rmw_publisher_t * pub;          // Publisher on the client's response topic
+} responder_t;
+
+// Stored in rmw_service_t::data
+typedef struct hazcat_service_info
+{
+  rmw_subscription_t * requests;  // Subscription to the request topic
+  const rmw_node_t * node;        // Node the service and its publishers belong to
+  const rosidl_message_type_support_t * response_type;
+  rmw_qos_profile_t qos;          // For response publishers
+  pthread_mutex_t lock;           // Protects responders and their publishers while in use
+  size_t responder_count;
+  size_t responder_capacity;      // Length of responders[]
+  responder_t * responders;       // One per live client answered so far, NULL if none
+} service_info_t;
+
+// Stored in rmw_client_t::data
+typedef struct hazcat_client_info
+{
+  rmw_publisher_t * requests;     // Publisher on the request topic
+  rmw_subscription_t * responses; // Subscription to this client's response topic
+  gid_layout_t gid;               // Gid of requests, the writer_guid of every request
+  int64_t sequence_number;        // Requests sent so far (accessed atomically)
+} client_info_t;
+
+// Name of the topic requests to service_name travel on, or NULL if out of memory. Free with
+// rmw_free
+char *
+hazcat_request_topic(const char * service_name);
+
+// Name of the topic responses from service_name to client travel on, or NULL if out of memory.
+// Free with rmw_free
+char *
+hazcat_response_topic(const char * service_name, const gid_layout_t * client);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_HAZCAT__HAZCAT_SERVICE_H_
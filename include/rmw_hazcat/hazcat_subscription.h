@@ -0,0 +1,79 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rosidl_typesupport_introspection_c/message_introspection.h"
+
+#include "hazcat/types.h"
+
+#include "rmw_hazcat/hazcat_event.h"
+#include "rmw_hazcat/hazcat_gid.h"
+#include "rmw_hazcat/hazcat_typesupport.h"
+
+#ifndef RMW_HAZCAT__HAZCAT_SUBSCRIPTION_H_
+#define RMW_HAZCAT__HAZCAT_SUBSCRIPTION_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Publishers whose sequence numbers a subscription keeps track of. With more publishers on a topic
+// than this, the one tracked longest is forgotten to make room, and starts over as if new
+#define HAZCAT_TRACKED_PUBLISHERS 8
+
+typedef struct hazcat_publisher_sequence
+{
+  gid_layout_t gid;
+  uint64_t sequence_number;       // Last one taken from this publisher, 0 if the slot is free
+} publisher_sequence_t;
+
+// Stored in rmw_subscription_t::data. Like publisher_info_t, it begins with the pub_sub_data_t
+// that hazcat_take operates on. Taken blocks start with the publisher's message_header_t, which
+// is turned into rmw_message_info_t. There's no receive event in shared memory, so a message is
+// received when it's taken, and reception sequence numbers count takes.
+//
+// The queue's index wraps around every len entries, so a subscriber that falls a whole lap behind
+// looks no different from one that's caught up. Lost messages are counted from the sequence
+// numbers in the headers instead. Each publisher numbers its messages consecutively, so a gap
+// between two messages taken from the same publisher is how many were overwritten in between.
+// Messages that are lost before the first one taken from a publisher go unnoticed. Services and
+// clients turn counting off for their subscriptions, since responses carry the sequence numbers of
+// the requests they answer rather than consecutive ones.
+typedef struct hazcat_subscription_info
+{
+  pub_sub_data_t data;            // Must be first
+  const type_info_t * type;       // Message type, as resolved by hazcat_type_info
+  const rosidl_typesupport_introspection_c__MessageMembers * members;   // NULL if C++ only
+  bool is_flat;                   // No strings or sequences, message can be memcpy'd
+  bool ignore_local;              // Drop messages published by this process
+  bool count_lost;                // Count lost messages, false for services and clients
+  uint64_t received;              // Messages taken so far (accessed atomically)
+  int32_t graph_slot;             // Slot in the ROS graph, see hazcat_ros_graph.h
+  uint64_t lost;                  // Messages known to be lost (accessed atomically)
+  uint64_t lost_reported;         // lost as of the last RMW_EVENT_MESSAGE_LOST taken (atomic)
+  size_t next_tracked;            // Slot of publishers[] to take over next
+  publisher_sequence_t publishers[HAZCAT_TRACKED_PUBLISHERS];
+  rmw_qos_profile_t qos;          // As requested when the subscription was created
+  event_timer_t deadline;         // Drives RMW_EVENT_REQUESTED_DEADLINE_MISSED
+  event_timer_t liveliness;       // Drives RMW_EVENT_LIVELINESS_CHANGED
+} subscription_info_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_HAZCAT__HAZCAT_SUBSCRIPTION_H_
@@ -0,0 +1,70 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rosidl_runtime_c/message_type_support_struct.h"
+#include "rosidl_runtime_c/service_type_support_struct.h"
+
+#ifndef RMW_HAZCAT__HAZCAT_TYPESUPPORT_H_
+#define RMW_HAZCAT__HAZCAT_TYPESUPPORT_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Longest type name kept, terminator included
+#define HAZCAT_TYPE_NAME_MAX 256
+
+// What the rmw needs to know about a message type, worked out once per type support handle. The
+// C introspection typesupport is preferred, falling back to the C++ one
+typedef struct hazcat_type_info
+{
+  const rosidl_message_type_support_t * type_support;     // Handle this was resolved from
+  const rosidl_message_type_support_t * introspection;    // C or C++ introspection handle
+  bool is_cpp;                    // introspection is rosidl_typesupport_introspection_cpp
+  size_t size;                    // Size of the message struct
+  bool is_pod;                    // No strings or sequences, at any depth, so bitwise copyable
+  char type_name[HAZCAT_TYPE_NAME_MAX];   // ROS name, like "std_msgs/msg/String"
+} type_info_t;
+
+// Resolve a type support handle, or return the cached result of doing so. Lock-free, and the
+// result lives as long as the process. NULL, with the error set, if there's no introspection
+const type_info_t *
+hazcat_type_info(const rosidl_message_type_support_t * type_support);
+
+// Shorthand for hazcat_type_info(type_support)->introspection
+const rosidl_message_type_support_t *
+get_type_support(const rosidl_message_type_support_t * type_support);
+
+// Message type support handles for a service's requests and responses, made up once per service
+// type support handle. Like type_info_t, they live as long as the process, so they can be handed
+// to rmw_create_publisher and rmw_create_subscription, and cached by hazcat_type_info
+typedef struct hazcat_service_type_info
+{
+  const rosidl_service_type_support_t * type_support;     // Handle this was resolved from
+  const rosidl_message_type_support_t * request;          // C or C++ introspection handle
+  const rosidl_message_type_support_t * response;         // Same flavour as request
+} service_type_info_t;
+
+const service_type_info_t *
+hazcat_service_type_info(const rosidl_service_type_support_t * type_support);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_HAZCAT__HAZCAT_TYPESUPPORT_H_
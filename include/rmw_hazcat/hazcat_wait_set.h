@@ -0,0 +1,109 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "hazcat/types.h"
+
+#ifndef RMW_HAZCAT__HAZCAT_WAIT_SET_H_
+#define RMW_HAZCAT__HAZCAT_WAIT_SET_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef enum hazcat_wait_kind
+{
+  WAIT_SUBSCRIPTION,               // Message queue of a subscription, service, or client
+  WAIT_GUARD_CONDITION,
+  WAIT_EVENT,                      // Timer of a deadline or liveliness event, see hazcat_event.h
+  WAIT_TIMER
+} wait_kind_t;
+
+// One file descriptor registered with a wait set's epoll instance. Its address is the
+// epoll_event.data.ptr of the registration, so it never moves while registered
+typedef struct hazcat_wait_entry
+{
+  int fd;                         // Registered file descriptor
+  wait_kind_t kind;               // What owner is
+  const void * owner;             // mq_node_t, guard_condition_info_t or event_timer_t, if any
+  uint64_t stamp;                 // Last rmw_wait call that asked for this fd
+  uint64_t ready_stamp;           // Last rmw_wait call that found a subscription on it ready
+  int first;                      // First position using fd in the current call, -1 if none
+} wait_entry_t;
+
+// Stored in rmw_wait_set_t::data. Executors pass (nearly) the same entities to every rmw_wait
+// call, so registrations are left in the epoll instance between calls. table[] remembers what is
+// registered, and each call only adds the entities that are new and removes the ones that are
+// gone, instead of paying for an epoll_ctl per entity.
+//
+// Positions are indices into the current call's arrays, subscriptions first, then services,
+// clients, guard conditions, and events. Services and clients wait on the message queue of their
+// internal subscription, so every position before the guard conditions has a queue, kept in
+// queues[].
+// Several subscriptions to one topic share an fd, so each entry heads a chain of positions through
+// links[]. After a wakeup, only the entries epoll reports are looked at, and marks[] records which
+// positions turned out to be ready.
+//
+// With a spin budget, rmw_wait first polls the subscriptions' queue indices in shared memory, the
+// guard conditions' pending flags, and every so often epoll, for up to spin_ns before blocking. A
+// message published in that window is picked up without a syscall or signal delivery in its path,
+// at the price of a busy core.
+//
+// Timeouts have nanosecond resolution. They're passed to epoll_pwait2 where the kernel has it.
+// Otherwise, timeouts that aren't whole milliseconds arm a timerfd that's registered alongside
+// everything else, and epoll_wait blocks until something, possibly the timer, fires.
+//
+// A destroyed entity's fd can be closed, dropping its registration, and a new entity can show up
+// with the same fd number and even the same address before the wait set notices. Destroying a
+// subscription or guard condition calls hazcat_wait_set_invalidate, and every wait set rebuilds
+// its epoll instance from scratch on its next rmw_wait. Services and clients get the same by
+// destroying their internal subscriptions.
+typedef struct hazcat_wait_set_info
+{
+  waitset_t ws;                   // Must be first
+  uint64_t stamp;                 // Number of rmw_wait calls so far
+  uint64_t spin_ns;               // How long to spin before blocking, 0 to block right away
+  uint32_t epoch;                 // Invalidation count this wait set's registrations are valid for
+  size_t count;                   // Number of registered fds
+  size_t capacity;                // Length of table[], a power of 2
+  wait_entry_t ** table;          // Registered fds, open addressing keyed by fd, NULL if empty
+  size_t evlist_capacity;         // Length of ws.evlist
+  size_t position_capacity;       // Length of links[] and marks[]
+  int * links;                    // Next position sharing an entry, -1 ends the chain
+  uint64_t * marks;               // Last rmw_wait call that found each position ready
+  pub_sub_data_t ** queues;       // Subscription data waited on at each queue position
+  wait_entry_t timer;             // Timeout timer when epoll_pwait2 isn't available, fd -1 if unused
+  bool timer_registered;          // Timer is in the current epoll instance
+  bool timer_armed;               // Timer is counting down, or has fired and not been read
+} wait_set_info_t;
+
+// Make rmw_wait spin for up to spin_ns nanoseconds before blocking on this wait set. Overrides the
+// budget from rmw_hazcat_init_options_set_wait_spin. 0 blocks right away
+rmw_ret_t
+rmw_hazcat_wait_set_set_spin(rmw_wait_set_t * wait_set, uint64_t spin_ns);
+
+// Forces every wait set in this process to drop its epoll registrations before its next wait
+void
+hazcat_wait_set_invalidate(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_HAZCAT__HAZCAT_WAIT_SET_H_
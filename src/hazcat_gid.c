@@ -0,0 +1,113 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/random.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rmw/rmw.h"
+
+#include "rmw_hazcat/hazcat_gid.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+_Static_assert(sizeof(gid_layout_t) <= RMW_GID_STORAGE_SIZE, "gid layout doesn't fit rmw_gid_t");
+
+static pthread_once_t gid_once = PTHREAD_ONCE_INIT;
+static uint32_t gid_host;
+static uint32_t gid_pid;
+static uint32_t gid_nonce;
+static uint32_t gid_count;      // Accessed atomically
+
+// FNV-1a
+static uint32_t
+hash(const uint8_t * data, size_t len)
+{
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h = (h ^ data[i]) * 16777619u;
+  }
+  return h;
+}
+
+// A forked child is a new process, and gets its own pid and nonce
+static void
+draw_nonce(void)
+{
+  gid_pid = (uint32_t)getpid();
+  if (sizeof(gid_nonce) != getrandom(&gid_nonce, sizeof(gid_nonce), GRND_NONBLOCK)) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t seed = ((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec) ^ (uintptr_t)&ts;
+    gid_nonce = hash((const uint8_t *)&seed, sizeof(seed));
+  }
+}
+
+static void
+init_gid_source(void)
+{
+  // The boot id changes with every boot of every host. Without procfs, fall back on the host id
+  char boot_id[64];
+  ssize_t len = -1;
+  int fd = open("/proc/sys/kernel/random/boot_id", O_RDONLY | O_CLOEXEC);
+  if (fd >= 0) {
+    len = read(fd, boot_id, sizeof(boot_id));
+    close(fd);
+  }
+  if (len > 0) {
+    gid_host = hash((const uint8_t *)boot_id, len);
+  } else {
+    long host = gethostid();
+    gid_host = hash((const uint8_t *)&host, sizeof(host));
+  }
+
+  draw_nonce();
+  pthread_atfork(NULL, NULL, draw_nonce);
+}
+
+rmw_gid_t
+hazcat_generate_gid(void)
+{
+  pthread_once(&gid_once, init_gid_source);
+
+  gid_layout_t layout;
+  layout.host = gid_host;
+  layout.pid = gid_pid;
+  layout.nonce = gid_nonce;
+  layout.count = __atomic_fetch_add(&gid_count, 1, __ATOMIC_RELAXED);
+
+  rmw_gid_t gid;
+  gid.implementation_identifier = rmw_get_implementation_identifier();
+  memset(&gid.data[0], 0, RMW_GID_STORAGE_SIZE);
+  memcpy(&gid.data[0], &layout, sizeof(layout));
+
+  return gid;
+}
+
+bool
+hazcat_gid_is_local(const gid_layout_t * gid)
+{
+  pthread_once(&gid_once, init_gid_source);
+  return gid->host == gid_host && gid->pid == gid_pid && gid->nonce == gid_nonce;
+}
+
+#ifdef __cplusplus
+}
+#endif
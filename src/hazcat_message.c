@@ -0,0 +1,488 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "rmw/allocators.h"
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rosidl_runtime_c/message_initialization.h"
+#include "rosidl_runtime_c/string.h"
+#include "rosidl_runtime_c/string_functions.h"
+#include "rosidl_runtime_c/u16string_functions.h"
+
+#include "rosidl_typesupport_introspection_c/field_types.h"
+#include "rosidl_typesupport_introspection_c/identifier.h"
+#include "rosidl_typesupport_introspection_c/message_introspection.h"
+
+#include "rmw_hazcat/hazcat_message.h"
+#include "rmw_hazcat/hazcat_typesupport.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Packed payloads are aligned strictly enough for any element type
+#define PAYLOAD_ALIGNMENT 16
+#define ALIGN_UP(x) (((x) + PAYLOAD_ALIGNMENT - 1) & ~((size_t)PAYLOAD_ALIGNMENT - 1))
+
+#define OFFSET_TO_PTR(off) ((void *)(uintptr_t)(off))
+#define PTR_TO_OFFSET_(ptr) ((size_t)(uintptr_t)(ptr))
+
+_Static_assert(
+  sizeof(message_header_t) <= HAZCAT_MESSAGE_HEADER_SIZE, "message header doesn't fit its room");
+
+static inline const rosidl_typesupport_introspection_c__MessageMembers *
+sub_members(const rosidl_typesupport_introspection_c__MessageMember * member)
+{
+  return (const rosidl_typesupport_introspection_c__MessageMembers *)member->members_->data;
+}
+
+size_t
+hazcat_member_element_size(const rosidl_typesupport_introspection_c__MessageMember * member)
+{
+  switch (member->type_id_) {
+    case rosidl_typesupport_introspection_c__ROS_TYPE_FLOAT:
+      return sizeof(float);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_DOUBLE:
+      return sizeof(double);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_LONG_DOUBLE:
+      return sizeof(long double);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_CHAR:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_BOOLEAN:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_OCTET:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT8:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT8:
+      return sizeof(uint8_t);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_WCHAR:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT16:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT16:
+      return sizeof(uint16_t);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT32:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT32:
+      return sizeof(uint32_t);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT64:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT64:
+      return sizeof(uint64_t);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_STRING:
+      return sizeof(rosidl_runtime_c__String);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_WSTRING:
+      return sizeof(rosidl_runtime_c__U16String);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE:
+      return sub_members(member)->size_of_;
+    default:
+      return 0;
+  }
+}
+
+const rosidl_typesupport_introspection_c__MessageMembers *
+hazcat_message_members(const rosidl_message_type_support_t * type_support)
+{
+  const type_info_t * info = hazcat_type_info(type_support);
+  if (NULL == info || info->is_cpp) {
+    return NULL;
+  }
+  return (const rosidl_typesupport_introspection_c__MessageMembers *)info->introspection->data;
+}
+
+static size_t
+pack_struct(
+  const rosidl_typesupport_introspection_c__MessageMembers * members,
+  const uint8_t * src, uint8_t * dst, uint8_t * block, size_t end);
+
+// Append the payload of one string or sequence at end, and point the copy of it in dst at the
+// payload. If block is NULL, nothing is written and only the new end is computed
+static size_t
+pack_dynamic(
+  const rosidl_typesupport_introspection_c__MessageMember * member,
+  const sequence_t * src, sequence_t * dst, uint8_t * block, size_t end, bool is_string)
+{
+  size_t elem;
+  size_t count = src->size;
+  if (is_string) {
+    elem = (rosidl_typesupport_introspection_c__ROS_TYPE_WSTRING == member->type_id_) ?
+      sizeof(uint16_t) : sizeof(char);
+    count++;    // Keep the terminator
+  } else {
+    elem = hazcat_member_element_size(member);
+    if (0 == count) {
+      if (NULL != block) {
+        dst->data = OFFSET_TO_PTR(0);
+        dst->size = 0;
+        dst->capacity = 0;
+      }
+      return end;
+    }
+  }
+
+  end = ALIGN_UP(end);
+  size_t start = end;
+  end += count * elem;
+  if (NULL != block) {
+    if (NULL != src->data) {
+      memcpy(block + start, src->data, count * elem);
+    } else {
+      memset(block + start, 0, count * elem);
+    }
+    dst->data = OFFSET_TO_PTR(start);
+    dst->size = src->size;
+    dst->capacity = count;
+  }
+  if (is_string) {
+    return end;
+  }
+
+  // Elements that are themselves strings or messages need their own payloads packed in
+  for (size_t i = 0; i < src->size; i++) {
+    const uint8_t * src_elem = (const uint8_t *)src->data + i * elem;
+    uint8_t * dst_elem = (NULL != block) ? block + start + i * elem : NULL;
+    switch (member->type_id_) {
+      case rosidl_typesupport_introspection_c__ROS_TYPE_STRING:
+      case rosidl_typesupport_introspection_c__ROS_TYPE_WSTRING:
+        end = pack_dynamic(
+          member, (const sequence_t *)src_elem, (sequence_t *)dst_elem, block, end, true);
+        break;
+      case rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE:
+        end = pack_struct(sub_members(member), src_elem, dst_elem, block, end);
+        break;
+      default:
+        break;
+    }
+  }
+
+  return end;
+}
+
+static size_t
+pack_struct(
+  const rosidl_typesupport_introspection_c__MessageMembers * members,
+  const uint8_t * src, uint8_t * dst, uint8_t * block, size_t end)
+{
+  for (uint32_t i = 0; i < members->member_count_; i++) {
+    const rosidl_typesupport_introspection_c__MessageMember * member = members->members_ + i;
+    const uint8_t * src_field = src + member->offset_;
+    uint8_t * dst_field = (NULL != block) ? dst + member->offset_ : NULL;
+
+    if (hazcat_member_is_sequence(member)) {
+      end = pack_dynamic(
+        member, (const sequence_t *)src_field, (sequence_t *)dst_field, block, end, false);
+      continue;
+    }
+
+    // Single values and fixed size arrays live inside the struct, which has already been copied.
+    // Only strings and nested messages can have payloads of their own
+    if (rosidl_typesupport_introspection_c__ROS_TYPE_STRING != member->type_id_ &&
+      rosidl_typesupport_introspection_c__ROS_TYPE_WSTRING != member->type_id_ &&
+      rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE != member->type_id_)
+    {
+      continue;
+    }
+    size_t count = member->is_array_ ? member->array_size_ : 1;
+    size_t elem = hazcat_member_element_size(member);
+    for (size_t j = 0; j < count; j++) {
+      switch (member->type_id_) {
+        case rosidl_typesupport_introspection_c__ROS_TYPE_STRING:
+        case rosidl_typesupport_introspection_c__ROS_TYPE_WSTRING:
+          end = pack_dynamic(
+            member, (const sequence_t *)(src_field + j * elem),
+            (NULL != block) ? (sequence_t *)(dst_field + j * elem) : NULL, block, end, true);
+          break;
+        case rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE:
+          end = pack_struct(
+            sub_members(member), src_field + j * elem,
+            (NULL != block) ? dst_field + j * elem : NULL, block, end);
+          break;
+        default:
+          break;
+      }
+    }
+  }
+
+  return end;
+}
+
+size_t
+hazcat_message_size(
+  const rosidl_typesupport_introspection_c__MessageMembers * members,
+  const void * ros_message)
+{
+  return pack_struct(members, (const uint8_t *)ros_message, NULL, NULL, members->size_of_);
+}
+
+// Payload sizes that can't be bounded, because of an unbounded string or sequence
+#define UNBOUNDED SIZE_MAX
+
+static inline size_t
+add_bounded(size_t a, size_t b)
+{
+  return (UNBOUNDED == a || UNBOUNDED == b) ? UNBOUNDED : a + b;
+}
+
+static inline size_t
+mul_bounded(size_t a, size_t n)
+{
+  return (UNBOUNDED == a) ? UNBOUNDED : a * n;
+}
+
+static size_t
+max_payload(const rosidl_typesupport_introspection_c__MessageMembers * members);
+
+// Most bytes one element of member can pack in behind the message, besides the element itself.
+// Every payload may need padding to PAYLOAD_ALIGNMENT in front of it
+static size_t
+max_element_payload(const rosidl_typesupport_introspection_c__MessageMember * member)
+{
+  switch (member->type_id_) {
+    case rosidl_typesupport_introspection_c__ROS_TYPE_STRING:
+      if (0 == member->string_upper_bound_) {
+        return UNBOUNDED;
+      }
+      return PAYLOAD_ALIGNMENT - 1 + (member->string_upper_bound_ + 1) * sizeof(char);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_WSTRING:
+      if (0 == member->string_upper_bound_) {
+        return UNBOUNDED;
+      }
+      return PAYLOAD_ALIGNMENT - 1 + (member->string_upper_bound_ + 1) * sizeof(uint16_t);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE:
+      return max_payload(sub_members(member));
+    default:
+      return 0;
+  }
+}
+
+// Most bytes a message of type members can pack in behind its struct, mirroring pack_struct
+static size_t
+max_payload(const rosidl_typesupport_introspection_c__MessageMembers * members)
+{
+  size_t total = 0;
+  for (uint32_t i = 0; i < members->member_count_; i++) {
+    const rosidl_typesupport_introspection_c__MessageMember * member = members->members_ + i;
+    size_t payload = max_element_payload(member);
+    if (hazcat_member_is_sequence(member)) {
+      if (!member->is_upper_bound_) {
+        return UNBOUNDED;
+      }
+      size_t elements = member->array_size_ * hazcat_member_element_size(member);
+      payload = add_bounded(
+        PAYLOAD_ALIGNMENT - 1 + elements, mul_bounded(payload, member->array_size_));
+    } else if (member->is_array_) {
+      payload = mul_bounded(payload, member->array_size_);
+    }
+    total = add_bounded(total, payload);
+  }
+  return total;
+}
+
+size_t
+hazcat_message_max_size(const rosidl_typesupport_introspection_c__MessageMembers * members)
+{
+  size_t payload = max_payload(members);
+  return (UNBOUNDED == payload) ? 0 : members->size_of_ + payload;
+}
+
+size_t
+hazcat_message_block_size(
+  const rosidl_typesupport_introspection_c__MessageMembers * members, bool is_flat,
+  size_t msg_size)
+{
+  if (is_flat) {
+    return HAZCAT_MESSAGE_HEADER_SIZE + msg_size;
+  }
+  size_t max_size = hazcat_message_max_size(members);
+  if (0 == max_size) {
+    max_size = msg_size + HAZCAT_DEFAULT_PAYLOAD_SIZE;
+  }
+  return HAZCAT_MESSAGE_HEADER_SIZE + max_size;
+}
+
+void
+hazcat_message_pack(
+  const rosidl_typesupport_introspection_c__MessageMembers * members,
+  const void * ros_message,
+  void * block)
+{
+  memcpy(block, ros_message, members->size_of_);
+  pack_struct(
+    members, (const uint8_t *)ros_message, (uint8_t *)block, (uint8_t *)block, members->size_of_);
+}
+
+static rmw_ret_t
+unpack_struct(
+  const rosidl_typesupport_introspection_c__MessageMembers * members,
+  const uint8_t * src, const uint8_t * block, uint8_t * dst);
+
+// Copy one packed element into an initialized element of the destination message
+static rmw_ret_t
+unpack_element(
+  const rosidl_typesupport_introspection_c__MessageMember * member,
+  const uint8_t * src, const uint8_t * block, uint8_t * dst, size_t elem)
+{
+  const sequence_t * src_str = (const sequence_t *)src;
+  switch (member->type_id_) {
+    case rosidl_typesupport_introspection_c__ROS_TYPE_STRING:
+      if (!rosidl_runtime_c__String__assignn(
+          (rosidl_runtime_c__String *)dst,
+          (const char *)(block + PTR_TO_OFFSET_(src_str->data)), src_str->size))
+      {
+        RMW_SET_ERROR_MSG("Unable to assign string");
+        return RMW_RET_BAD_ALLOC;
+      }
+      return RMW_RET_OK;
+    case rosidl_typesupport_introspection_c__ROS_TYPE_WSTRING:
+      if (!rosidl_runtime_c__U16String__assignn(
+          (rosidl_runtime_c__U16String *)dst,
+          (const uint16_t *)(block + PTR_TO_OFFSET_(src_str->data)), src_str->size))
+      {
+        RMW_SET_ERROR_MSG("Unable to assign wstring");
+        return RMW_RET_BAD_ALLOC;
+      }
+      return RMW_RET_OK;
+    case rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE:
+      return unpack_struct(sub_members(member), src, block, dst);
+    default:
+      memcpy(dst, src, elem);
+      return RMW_RET_OK;
+  }
+}
+
+static rmw_ret_t
+unpack_struct(
+  const rosidl_typesupport_introspection_c__MessageMembers * members,
+  const uint8_t * src, const uint8_t * block, uint8_t * dst)
+{
+  rmw_ret_t ret;
+  for (uint32_t i = 0; i < members->member_count_; i++) {
+    const rosidl_typesupport_introspection_c__MessageMember * member = members->members_ + i;
+    const uint8_t * src_field = src + member->offset_;
+    uint8_t * dst_field = dst + member->offset_;
+    size_t elem = hazcat_member_element_size(member);
+
+    if (hazcat_member_is_sequence(member)) {
+      const sequence_t * src_seq = (const sequence_t *)src_field;
+      if (NULL == member->resize_function ||
+        !member->resize_function(dst_field, src_seq->size))
+      {
+        RMW_SET_ERROR_MSG("Unable to resize sequence");
+        return RMW_RET_BAD_ALLOC;
+      }
+      if (0 == src_seq->size) {
+        continue;
+      }
+      const uint8_t * src_data = block + PTR_TO_OFFSET_(src_seq->data);
+      uint8_t * dst_data = ((sequence_t *)dst_field)->data;
+      if (rosidl_typesupport_introspection_c__ROS_TYPE_STRING != member->type_id_ &&
+        rosidl_typesupport_introspection_c__ROS_TYPE_WSTRING != member->type_id_ &&
+        rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE != member->type_id_)
+      {
+        memcpy(dst_data, src_data, src_seq->size * elem);
+        continue;
+      }
+      for (size_t j = 0; j < src_seq->size; j++) {
+        ret = unpack_element(member, src_data + j * elem, block, dst_data + j * elem, elem);
+        if (RMW_RET_OK != ret) {
+          return ret;
+        }
+      }
+      continue;
+    }
+
+    size_t count = member->is_array_ ? member->array_size_ : 1;
+    if (rosidl_typesupport_introspection_c__ROS_TYPE_STRING != member->type_id_ &&
+      rosidl_typesupport_introspection_c__ROS_TYPE_WSTRING != member->type_id_ &&
+      rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE != member->type_id_)
+    {
+      memcpy(dst_field, src_field, count * elem);
+      continue;
+    }
+    for (size_t j = 0; j < count; j++) {
+      ret = unpack_element(member, src_field + j * elem, block, dst_field + j * elem, elem);
+      if (RMW_RET_OK != ret) {
+        return ret;
+      }
+    }
+  }
+
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+hazcat_message_unpack(
+  const rosidl_typesupport_introspection_c__MessageMembers * members,
+  const void * block,
+  void * ros_message)
+{
+  return unpack_struct(
+    members, (const uint8_t *)block, (const uint8_t *)block, (uint8_t *)ros_message);
+}
+
+rmw_ret_t
+hazcat_allocation_init(
+  const rosidl_message_type_support_t * type_support,
+  allocation_info_t ** allocation)
+{
+  allocation_info_t * info = rmw_allocate(sizeof(allocation_info_t));
+  if (NULL == info) {
+    RMW_SET_ERROR_MSG("Unable to allocate memory for allocation");
+    return RMW_RET_BAD_ALLOC;
+  }
+  const type_info_t * type = hazcat_type_info(type_support);
+  if (NULL == type) {
+    rmw_free(info);
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  info->members = type->is_cpp ? NULL :
+    (const rosidl_typesupport_introspection_c__MessageMembers *)type->introspection->data;
+  info->scratch = NULL;
+
+  if (NULL != info->members && !type->is_pod) {
+    info->scratch = rmw_allocate(info->members->size_of_);
+    if (NULL == info->scratch) {
+      RMW_SET_ERROR_MSG("Unable to allocate memory for scratch message");
+      rmw_free(info);
+      return RMW_RET_BAD_ALLOC;
+    }
+    info->members->init_function(info->scratch, ROSIDL_RUNTIME_C_MSG_INIT_ALL);
+  }
+
+  *allocation = info;
+  return RMW_RET_OK;
+}
+
+void
+hazcat_allocation_fini(allocation_info_t * allocation)
+{
+  if (NULL != allocation->scratch) {
+    allocation->members->fini_function(allocation->scratch);
+    rmw_free(allocation->scratch);
+  }
+  rmw_free(allocation);
+}
+
+void *
+hazcat_allocation_scratch(
+  const allocation_info_t * allocation,
+  const rosidl_typesupport_introspection_c__MessageMembers * members)
+{
+  if (NULL == allocation || allocation->members != members) {
+    return NULL;
+  }
+  return allocation->scratch;
+}
+
+#ifdef __cplusplus
+}
+#endif
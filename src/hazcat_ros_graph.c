@@ -12,11 +12,1263 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "rcutils/strdup.h"
+
+#include "rmw/allocators.h"
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_hazcat/hazcat_event.h"
+#include "rmw_hazcat/hazcat_ros_graph.h"
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+#define HAZCAT_GRAPH_MAGIC 0x48475234   // "HGR4"
+
+// How long to wait for another process to finish creating the graph, in milliseconds
+#define ATTACH_TIMEOUT_MS 1000
+
+#define TOPIC_EMPTY -1
+#define TOPIC_REMOVED -2
+
+static pthread_once_t graph_once = PTHREAD_ONCE_INIT;
+static graph_t * graph = NULL;
+
+// Graph guard conditions of this process's nodes, or timerfds of its subscriptions' liveliness
+// events, and the thread that fires them
+typedef struct graph_watcher
+{
+  const rmw_guard_condition_t * guard_condition;    // NULL if this is a timerfd
+  int fd;                                           // -1 if this is a guard condition
+} graph_watcher_t;
+
+static pthread_mutex_t watchers_lock = PTHREAD_MUTEX_INITIALIZER;
+static graph_watcher_t * watchers = NULL;
+static size_t watcher_count = 0;
+static size_t watcher_capacity = 0;
+static bool watcher_running = false;
+static bool watcher_atfork = false;
+
+// FNV-1a
+static uint32_t
+hash_name(const char * name)
+{
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < HAZCAT_GRAPH_NAME_MAX && '\0' != name[i]; i++) {
+    h = (h ^ (uint8_t)name[i]) * 16777619u;
+  }
+  return h;
+}
+
+// This process, but for pid, which changes across fork. Set when the graph is mapped
+static graph_process_t self_process = {0, 0, 0};
+
+static void
+identify_self(void)
+{
+  char boot_id[64] = "";
+  FILE * f = fopen("/proc/sys/kernel/random/boot_id", "r");
+  if (NULL != f) {
+    if (NULL == fgets(boot_id, sizeof(boot_id), f)) {
+      boot_id[0] = '\0';
+    }
+    fclose(f);
+  }
+  self_process.boot_id = hash_name(boot_id);
+
+  struct stat st;
+  self_process.pid_ns = (0 == stat("/proc/self/ns/pid", &st)) ? (uint64_t)st.st_ino : 0;
+}
+
+static graph_process_t
+this_process(void)
+{
+  graph_process_t process = self_process;
+  process.pid = getpid();
+  return process;
+}
+
+// Whether process can be checked on from here, which it can't from another PID namespace
+static bool
+process_in_reach(const graph_process_t * process)
+{
+  return process->boot_id != self_process.boot_id || process->pid_ns == self_process.pid_ns;
+}
+
+// Processes out of reach are assumed to be alive, those from an earlier boot are certainly not
+static bool
+process_alive(const graph_process_t * process)
+{
+  if (process->boot_id != self_process.boot_id) {
+    return false;
+  }
+  if (process->pid_ns != self_process.pid_ns) {
+    return true;
+  }
+  return 0 == kill(process->pid, 0) || EPERM == errno;
+}
+
+static void
+lock_graph(graph_t * g)
+{
+  if (EOWNERDEAD == pthread_mutex_lock(&g->lock)) {
+    // The last writer died holding the lock. Whatever it was doing is left half done, but a seq
+    // left odd would stall every reader for good
+    uint32_t seq = __atomic_load_n(&g->seq, __ATOMIC_RELAXED);
+    if (seq & 1) {
+      __atomic_store_n(&g->seq, seq + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_consistent(&g->lock);
+  }
+}
+
+static void
+begin_write(graph_t * g)
+{
+  lock_graph(g);
+  __atomic_store_n(&g->seq, g->seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+// Wake every process watching the graph
+static void
+notify(graph_t * g)
+{
+  __atomic_fetch_add(&g->generation, 1, __ATOMIC_RELEASE);
+  syscall(SYS_futex, &g->generation, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static void
+end_write(graph_t * g)
+{
+  __atomic_store_n(&g->seq, g->seq + 1, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&g->lock);
+  notify(g);
+}
+
+static uint32_t
+begin_read(graph_t * g)
+{
+  uint32_t seq = __atomic_load_n(&g->seq, __ATOMIC_ACQUIRE);
+  while (seq & 1) {
+    // Wait the update out on the lock, which also repairs seq if the writer died
+    lock_graph(g);
+    pthread_mutex_unlock(&g->lock);
+    seq = __atomic_load_n(&g->seq, __ATOMIC_ACQUIRE);
+  }
+  return seq;
+}
+
+// Whether what was read since begin_read returned seq may be torn, and has to be read again
+static bool
+retry_read(graph_t * g, uint32_t seq)
+{
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&g->seq, __ATOMIC_RELAXED) != seq;
+}
+
+// Slot of the topic called name, or -1. Safe to call while reading, since every probe is bounded
+static int32_t
+find_topic(const graph_t * g, const char * name, uint32_t hash)
+{
+  uint32_t mask = HAZCAT_GRAPH_TOPIC_BUCKETS - 1;
+  for (uint32_t i = 0, b = hash & mask; i < HAZCAT_GRAPH_TOPIC_BUCKETS; i++, b = (b + 1) & mask) {
+    int32_t slot = g->topic_index[b];
+    if (TOPIC_EMPTY == slot) {
+      return -1;
+    }
+    if (slot >= 0 && slot < HAZCAT_GRAPH_MAX_TOPICS &&
+      0 == strncmp(g->topics[slot].name, name, HAZCAT_GRAPH_NAME_MAX))
+    {
+      return slot;
+    }
+  }
+  return -1;
+}
+
+static void
+index_topic(graph_t * g, int32_t slot, uint32_t hash)
+{
+  uint32_t mask = HAZCAT_GRAPH_TOPIC_BUCKETS - 1;
+  uint32_t b = hash & mask;
+  while (g->topic_index[b] >= 0) {
+    b = (b + 1) & mask;
+  }
+  if (TOPIC_REMOVED == g->topic_index[b]) {
+    g->topic_tombstones--;
+  }
+  g->topic_index[b] = slot;
+}
+
+// Probes step over the tombstones removed topics leave behind. Once there are enough of them to
+// slow probes down, start the index over with only the topics in use
+static void
+rebuild_topic_index(graph_t * g)
+{
+  for (uint32_t b = 0; b < HAZCAT_GRAPH_TOPIC_BUCKETS; b++) {
+    g->topic_index[b] = TOPIC_EMPTY;
+  }
+  g->topic_tombstones = 0;
+  for (int32_t slot = 0; slot < g->topic_high; slot++) {
+    graph_topic_t * topic = &g->topics[slot];
+    if (topic->publisher_count + topic->subscription_count > 0) {
+      index_topic(g, slot, hash_name(topic->name));
+    }
+  }
+}
+
+// Slot of the topic called name, added if it isn't there yet. -1 if the table is full
+static int32_t
+add_topic(graph_t * g, const char * name)
+{
+  uint32_t hash = hash_name(name);
+  int32_t slot = find_topic(g, name, hash);
+  if (-1 != slot) {
+    return slot;
+  }
+
+  if (-1 != g->topic_free) {
+    slot = g->topic_free;
+    g->topic_free = g->topics[slot].first;
+  } else if (g->topic_high < HAZCAT_GRAPH_MAX_TOPICS) {
+    slot = g->topic_high++;
+  } else {
+    return -1;
+  }
+  graph_topic_t * topic = &g->topics[slot];
+  topic->first = -1;
+  topic->publisher_count = 0;
+  topic->subscription_count = 0;
+  snprintf(topic->name, sizeof(topic->name), "%s", name);
+
+  if (g->topic_tombstones >= HAZCAT_GRAPH_TOPIC_BUCKETS / 4) {
+    rebuild_topic_index(g);
+  }
+  index_topic(g, slot, hash);
+  return slot;
+}
+
+// Drop a topic once its last endpoint is gone
+static void
+release_topic(graph_t * g, int32_t slot)
+{
+  graph_topic_t * topic = &g->topics[slot];
+  if (topic->publisher_count + topic->subscription_count > 0) {
+    return;
+  }
+
+  uint32_t mask = HAZCAT_GRAPH_TOPIC_BUCKETS - 1;
+  uint32_t b = hash_name(topic->name) & mask;
+  for (uint32_t i = 0; i < HAZCAT_GRAPH_TOPIC_BUCKETS; i++, b = (b + 1) & mask) {
+    if (g->topic_index[b] == slot) {
+      g->topic_index[b] = TOPIC_REMOVED;
+      g->topic_tombstones++;
+      break;
+    }
+  }
+  topic->name[0] = '\0';
+  topic->first = g->topic_free;
+  g->topic_free = slot;
+}
+
+static void
+remove_endpoint(graph_t * g, int32_t slot)
+{
+  graph_endpoint_t * endpoint = &g->endpoints[slot];
+  graph_topic_t * topic = &g->topics[endpoint->topic];
+  for (int32_t * link = &topic->first; -1 != *link; link = &g->endpoints[*link].next) {
+    if (*link == slot) {
+      *link = endpoint->next;
+      break;
+    }
+  }
+  if (GRAPH_PUBLISHER == endpoint->kind) {
+    topic->publisher_count--;
+  } else {
+    topic->subscription_count--;
+  }
+  release_topic(g, endpoint->topic);
+
+  endpoint->process.pid = 0;
+  endpoint->next = g->endpoint_free;
+  g->endpoint_free = slot;
+}
+
+static void
+remove_node(graph_t * g, int32_t slot)
+{
+  graph_node_t * node = &g->nodes[slot];
+  node->process.pid = 0;
+  node->next_free = g->node_free;
+  g->node_free = slot;
+}
+
+// Whether the process behind a slot is known to be gone. Free slots aren't
+static bool
+process_gone(const graph_process_t * process)
+{
+  return 0 != process->pid && process_in_reach(process) && !process_alive(process);
+}
+
+// Remove whatever processes that are gone left behind. Those in other PID namespaces are left to
+// a process there
+static void
+sweep(graph_t * g)
+{
+  begin_write(g);
+  for (int32_t slot = 0; slot < g->endpoint_high; slot++) {
+    if (process_gone(&g->endpoints[slot].process)) {
+      remove_endpoint(g, slot);
+    }
+  }
+  for (int32_t slot = 0; slot < g->node_high; slot++) {
+    if (process_gone(&g->nodes[slot].process)) {
+      remove_node(g, slot);
+    }
+  }
+  end_write(g);
+}
+
+static int
+init_graph(graph_t * g)
+{
+  pthread_mutexattr_t attr;
+  if (0 != pthread_mutexattr_init(&attr) ||
+    0 != pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED) ||
+    0 != pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST) ||
+    0 != pthread_mutex_init(&g->lock, &attr))
+  {
+    return -1;
+  }
+  pthread_mutexattr_destroy(&attr);
+
+  // Everything else starts out zeroed by ftruncate
+  g->node_free = -1;
+  g->topic_free = -1;
+  g->endpoint_free = -1;
+  for (uint32_t b = 0; b < HAZCAT_GRAPH_TOPIC_BUCKETS; b++) {
+    g->topic_index[b] = TOPIC_EMPTY;
+  }
+  __atomic_store_n(&g->magic, HAZCAT_GRAPH_MAGIC, __ATOMIC_RELEASE);
+  return 0;
+}
+
+static void
+map_graph(void)
+{
+  bool creator = true;
+  int fd = shm_open(HAZCAT_GRAPH_FILE, O_RDWR | O_CREAT | O_EXCL, 0666);
+  if (-1 == fd && EEXIST == errno) {
+    creator = false;
+    fd = shm_open(HAZCAT_GRAPH_FILE, O_RDWR, 0);
+  }
+  if (-1 == fd) {
+    perror("shm_open: ");
+    return;
+  }
+
+  if (creator) {
+    // Whatever the umask, every user's processes share the one graph
+    fchmod(fd, 0666);
+    if (-1 == ftruncate(fd, sizeof(graph_t))) {
+      perror("ftruncate: ");
+      close(fd);
+      shm_unlink(HAZCAT_GRAPH_FILE);
+      return;
+    }
+  } else {
+    // The creator may not have sized it yet
+    struct stat st;
+    for (int waited = 0; ; waited++) {
+      if (-1 == fstat(fd, &st)) {
+        perror("fstat: ");
+        close(fd);
+        return;
+      }
+      if (sizeof(graph_t) == st.st_size) {
+        break;
+      }
+      if (0 != st.st_size || waited == ATTACH_TIMEOUT_MS) {
+        fprintf(
+          stderr, "/dev/shm%s is from another version of rmw_hazcat, or its creator died. "
+          "Remove it once no ROS process is running\n", HAZCAT_GRAPH_FILE);
+        close(fd);
+        return;
+      }
+      usleep(1000);
+    }
+  }
+
+  graph_t * g = mmap(NULL, sizeof(graph_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (MAP_FAILED == g) {
+    perror("mmap: ");
+    return;
+  }
+
+  if (creator) {
+    if (-1 == init_graph(g)) {
+      fprintf(stderr, "Unable to initialize lock of /dev/shm%s\n", HAZCAT_GRAPH_FILE);
+      munmap(g, sizeof(graph_t));
+      shm_unlink(HAZCAT_GRAPH_FILE);
+      return;
+    }
+  } else {
+    for (int waited = 0; HAZCAT_GRAPH_MAGIC != __atomic_load_n(&g->magic, __ATOMIC_ACQUIRE);
+      waited++)
+    {
+      if (waited == ATTACH_TIMEOUT_MS) {
+        fprintf(
+          stderr, "/dev/shm%s was never initialized. Remove it once no ROS process is running\n",
+          HAZCAT_GRAPH_FILE);
+        munmap(g, sizeof(graph_t));
+        return;
+      }
+      usleep(1000);
+    }
+  }
+
+  identify_self();
+  sweep(g);
+  graph = g;
+}
+
+rmw_ret_t
+hazcat_graph_attach(graph_t ** g)
+{
+  pthread_once(&graph_once, map_graph);
+  if (NULL == graph) {
+    RMW_SET_ERROR_MSG("Unable to map ROS graph from shared memory");
+    return RMW_RET_ERROR;
+  }
+  *g = graph;
+  return RMW_RET_OK;
+}
+
+// Sleep until the graph changes, then fire every watcher. Changes made while the watchers are
+// being fired are caught by the next pass, so none goes unnoticed, though several may be reported
+// with one trigger
+static void *
+watch_graph(void * arg)
+{
+  graph_t * g = arg;
+  uint32_t seen = __atomic_load_n(&g->generation, __ATOMIC_ACQUIRE);
+  // Shortest relative time that arms a timerfd, since zero disarms it
+  const struct itimerspec fire_now = {.it_interval = {0, 0}, .it_value = {0, 1}};
+  for (;;) {
+    // Returns right away if generation has already moved on from seen
+    syscall(SYS_futex, &g->generation, FUTEX_WAIT, seen, NULL, NULL, 0);
+    uint32_t generation = __atomic_load_n(&g->generation, __ATOMIC_ACQUIRE);
+    if (generation == seen) {
+      continue;
+    }
+    seen = generation;
+
+    pthread_mutex_lock(&watchers_lock);
+    for (size_t i = 0; i < watcher_count; i++) {
+      if (NULL != watchers[i].guard_condition) {
+        rmw_trigger_guard_condition(watchers[i].guard_condition);
+      } else if (-1 == timerfd_settime(watchers[i].fd, 0, &fire_now, NULL)) {
+        perror("timerfd_settime: ");
+      }
+    }
+    pthread_mutex_unlock(&watchers_lock);
+  }
+  return NULL;
+}
+
+static void
+lock_watchers(void)
+{
+  pthread_mutex_lock(&watchers_lock);
+}
+
+static void
+unlock_watchers(void)
+{
+  pthread_mutex_unlock(&watchers_lock);
+}
+
+// Only the forking thread survives in the child, so the watcher thread has to be started again
+static void
+reset_watchers(void)
+{
+  watcher_running = false;
+  pthread_mutex_unlock(&watchers_lock);
+}
+
+static rmw_ret_t
+add_watcher(graph_watcher_t watcher)
+{
+  graph_t * g;
+  rmw_ret_t ret = hazcat_graph_attach(&g);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+
+  pthread_mutex_lock(&watchers_lock);
+  if (watcher_count == watcher_capacity) {
+    size_t capacity = (0 == watcher_capacity) ? 4 : 2 * watcher_capacity;
+    graph_watcher_t * grown = rmw_allocate(capacity * sizeof(graph_watcher_t));
+    if (NULL == grown) {
+      pthread_mutex_unlock(&watchers_lock);
+      RMW_SET_ERROR_MSG("Unable to allocate memory for graph watchers");
+      return RMW_RET_BAD_ALLOC;
+    }
+    if (NULL != watchers) {
+      memcpy(grown, watchers, watcher_count * sizeof(graph_watcher_t));
+      rmw_free(watchers);
+    }
+    watchers = grown;
+    watcher_capacity = capacity;
+  }
+
+  if (!watcher_running) {
+    if (!watcher_atfork) {
+      if (0 != pthread_atfork(lock_watchers, unlock_watchers, reset_watchers)) {
+        pthread_mutex_unlock(&watchers_lock);
+        RMW_SET_ERROR_MSG("Unable to register fork handlers for graph watcher");
+        return RMW_RET_ERROR;
+      }
+      watcher_atfork = true;
+    }
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int err = pthread_create(&thread, &attr, watch_graph, g);
+    pthread_attr_destroy(&attr);
+    if (0 != err) {
+      pthread_mutex_unlock(&watchers_lock);
+      RMW_SET_ERROR_MSG("Unable to start graph watcher thread");
+      return RMW_RET_ERROR;
+    }
+    watcher_running = true;
+  }
+
+  watchers[watcher_count++] = watcher;
+  pthread_mutex_unlock(&watchers_lock);
+
+  return RMW_RET_OK;
+}
+
+static void
+remove_watcher(graph_watcher_t watcher)
+{
+  pthread_mutex_lock(&watchers_lock);
+  for (size_t i = 0; i < watcher_count; i++) {
+    if (watchers[i].guard_condition == watcher.guard_condition && watchers[i].fd == watcher.fd) {
+      watchers[i] = watchers[--watcher_count];
+      break;
+    }
+  }
+  pthread_mutex_unlock(&watchers_lock);
+}
+
+rmw_ret_t
+hazcat_graph_watch(const rmw_guard_condition_t * guard_condition)
+{
+  return add_watcher((graph_watcher_t){guard_condition, -1});
+}
+
+void
+hazcat_graph_unwatch(const rmw_guard_condition_t * guard_condition)
+{
+  remove_watcher((graph_watcher_t){guard_condition, -1});
+}
+
+rmw_ret_t
+hazcat_graph_watch_timer(int fd)
+{
+  return add_watcher((graph_watcher_t){NULL, fd});
+}
+
+void
+hazcat_graph_unwatch_timer(int fd)
+{
+  remove_watcher((graph_watcher_t){NULL, fd});
+}
+
+static rmw_ret_t
+check_name(const char * name, const char * what)
+{
+  if (strlen(name) >= HAZCAT_GRAPH_NAME_MAX) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("%s is too long for the ROS graph: %s", what, name);
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+hazcat_graph_add_node(const rmw_node_t * node, int32_t * slot)
+{
+  graph_t * g;
+  rmw_ret_t ret;
+  const char * enclave = (NULL != node->context->options.enclave) ?
+    node->context->options.enclave : "";
+  if (RMW_RET_OK != (ret = hazcat_graph_attach(&g)) ||
+    RMW_RET_OK != (ret = check_name(node->name, "node name")) ||
+    RMW_RET_OK != (ret = check_name(node->namespace_, "node namespace")) ||
+    RMW_RET_OK != (ret = check_name(enclave, "enclave")))
+  {
+    return ret;
+  }
+
+  begin_write(g);
+  if (-1 != g->node_free) {
+    *slot = g->node_free;
+    g->node_free = g->nodes[*slot].next_free;
+  } else if (g->node_high < HAZCAT_GRAPH_MAX_NODES) {
+    *slot = g->node_high++;
+  } else {
+    end_write(g);
+    RMW_SET_ERROR_MSG("Too many nodes in the ROS graph");
+    return RMW_RET_ERROR;
+  }
+  graph_node_t * entry = &g->nodes[*slot];
+  entry->process = this_process();
+  snprintf(entry->name, sizeof(entry->name), "%s", node->name);
+  snprintf(entry->namespace_, sizeof(entry->namespace_), "%s", node->namespace_);
+  snprintf(entry->enclave, sizeof(entry->enclave), "%s", enclave);
+  end_write(g);
+
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+hazcat_graph_remove_node(int32_t slot)
+{
+  graph_t * g;
+  rmw_ret_t ret = hazcat_graph_attach(&g);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+
+  begin_write(g);
+  remove_node(g, slot);
+  end_write(g);
+
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+hazcat_graph_add_endpoint(
+  int32_t node_slot,
+  graph_endpoint_kind_t kind,
+  const char * topic_name,
+  const char * type_name,
+  const rmw_gid_t * gid,
+  const rmw_qos_profile_t * qos,
+  int32_t * slot)
+{
+  graph_t * g;
+  rmw_ret_t ret;
+  if (RMW_RET_OK != (ret = hazcat_graph_attach(&g)) ||
+    RMW_RET_OK != (ret = check_name(topic_name, "topic name")) ||
+    RMW_RET_OK != (ret = check_name(type_name, "type name")))
+  {
+    return ret;
+  }
+
+  begin_write(g);
+  int32_t topic_slot = add_topic(g, topic_name);
+  if (-1 == topic_slot) {
+    end_write(g);
+    RMW_SET_ERROR_MSG("Too many topics in the ROS graph");
+    return RMW_RET_ERROR;
+  }
+  if (-1 != g->endpoint_free) {
+    *slot = g->endpoint_free;
+    g->endpoint_free = g->endpoints[*slot].next;
+  } else if (g->endpoint_high < HAZCAT_GRAPH_MAX_ENDPOINTS) {
+    *slot = g->endpoint_high++;
+  } else {
+    release_topic(g, topic_slot);
+    end_write(g);
+    RMW_SET_ERROR_MSG("Too many endpoints in the ROS graph");
+    return RMW_RET_ERROR;
+  }
+
+  graph_topic_t * topic = &g->topics[topic_slot];
+  graph_endpoint_t * endpoint = &g->endpoints[*slot];
+  endpoint->process = this_process();
+  endpoint->kind = kind;
+  endpoint->node = node_slot;
+  endpoint->topic = topic_slot;
+  memcpy(endpoint->gid, gid->data, RMW_GID_STORAGE_SIZE);
+  endpoint->qos = *qos;
+  endpoint->asserted = hazcat_monotonic_now();
+  snprintf(endpoint->type, sizeof(endpoint->type), "%s", type_name);
+  endpoint->next = topic->first;
+  topic->first = *slot;
+  if (GRAPH_PUBLISHER == kind) {
+    topic->publisher_count++;
+  } else {
+    topic->subscription_count++;
+  }
+  end_write(g);
+
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+hazcat_graph_remove_endpoint(int32_t slot)
+{
+  graph_t * g;
+  rmw_ret_t ret = hazcat_graph_attach(&g);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+
+  begin_write(g);
+  remove_endpoint(g, slot);
+  end_write(g);
+
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+hazcat_graph_count(const char * topic_name, size_t * publishers, size_t * subscriptions)
+{
+  graph_t * g;
+  rmw_ret_t ret = hazcat_graph_attach(&g);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+
+  uint32_t hash = hash_name(topic_name);
+  uint32_t seq;
+  size_t publisher_count, subscription_count;
+  do {
+    seq = begin_read(g);
+    int32_t slot = find_topic(g, topic_name, hash);
+    publisher_count = (-1 != slot) ? g->topics[slot].publisher_count : 0;
+    subscription_count = (-1 != slot) ? g->topics[slot].subscription_count : 0;
+  } while (retry_read(g, seq));
+
+  if (NULL != publishers) {
+    *publishers = publisher_count;
+  }
+  if (NULL != subscriptions) {
+    *subscriptions = subscription_count;
+  }
+  return RMW_RET_OK;
+}
+
+void
+hazcat_graph_assert_liveliness(int32_t slot, int64_t now)
+{
+  graph_t * g;
+  if (RMW_RET_OK != hazcat_graph_attach(&g)) {
+    return;
+  }
+  graph_endpoint_t * endpoint = &g->endpoints[slot];
+  int64_t last = __atomic_exchange_n(&endpoint->asserted, now, __ATOMIC_ACQ_REL);
+  // Coming back to life is news to the subscriptions, which don't otherwise wake until a lease
+  // runs out
+  if (now - last >= hazcat_duration_ns(endpoint->qos.liveliness_lease_duration)) {
+    notify(g);
+  }
+}
+
+rmw_ret_t
+hazcat_graph_count_alive(
+  const char * topic_name,
+  int64_t now,
+  int32_t * alive,
+  int32_t * not_alive,
+  int64_t * next_expiry)
+{
+  graph_t * g;
+  rmw_ret_t ret = hazcat_graph_attach(&g);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+
+  uint32_t hash = hash_name(topic_name);
+  uint32_t seq;
+  do {
+    seq = begin_read(g);
+    *alive = 0;
+    *not_alive = 0;
+    *next_expiry = 0;
+    int32_t topic_slot = find_topic(g, topic_name, hash);
+    if (-1 == topic_slot) {
+      continue;
+    }
+
+    int32_t slot = g->topics[topic_slot].first;
+    for (int32_t hops = 0; slot >= 0 && slot < HAZCAT_GRAPH_MAX_ENDPOINTS &&
+      hops < HAZCAT_GRAPH_MAX_ENDPOINTS; hops++, slot = g->endpoints[slot].next)
+    {
+      const graph_endpoint_t * endpoint = &g->endpoints[slot];
+      if (GRAPH_PUBLISHER != endpoint->kind) {
+        continue;
+      }
+      bool is_alive = process_alive(&endpoint->process);
+      int64_t lease = hazcat_duration_ns(endpoint->qos.liveliness_lease_duration);
+      if (is_alive && RMW_QOS_POLICY_LIVELINESS_MANUAL_BY_TOPIC == endpoint->qos.liveliness &&
+        0 != lease)
+      {
+        int64_t expiry = __atomic_load_n(&endpoint->asserted, __ATOMIC_ACQUIRE) + lease;
+        is_alive = now < expiry;
+        if (is_alive && (0 == *next_expiry || expiry < *next_expiry)) {
+          *next_expiry = expiry;
+        }
+      }
+      if (is_alive) {
+        (*alive)++;
+      } else {
+        (*not_alive)++;
+      }
+    }
+  } while (retry_read(g, seq));
+
+  return RMW_RET_OK;
+}
+
+// What hazcat_graph_get_endpoint_info reports of an endpoint, copied out while reading
+typedef struct endpoint_info
+{
+  char node_name[HAZCAT_GRAPH_NAME_MAX];
+  char node_namespace[HAZCAT_GRAPH_NAME_MAX];
+  char type[HAZCAT_GRAPH_NAME_MAX];
+  uint8_t gid[RMW_GID_STORAGE_SIZE];
+  rmw_qos_profile_t qos;
+} endpoint_info_t;
+
+// Copy the endpoints of the given kind on topic_name into copies, which holds capacity of them.
+// Returns how many there are, which is more than capacity if they didn't all fit
+static size_t
+copy_endpoints(
+  graph_t * g,
+  const char * topic_name,
+  graph_endpoint_kind_t kind,
+  endpoint_info_t * copies,
+  size_t capacity)
+{
+  uint32_t hash = hash_name(topic_name);
+  uint32_t seq;
+  size_t count;
+  do {
+    seq = begin_read(g);
+    count = 0;
+    int32_t topic_slot = find_topic(g, topic_name, hash);
+    if (-1 == topic_slot) {
+      continue;
+    }
+
+    // A torn read could send the chain anywhere, including around in circles
+    int32_t slot = g->topics[topic_slot].first;
+    for (int32_t hops = 0; slot >= 0 && slot < HAZCAT_GRAPH_MAX_ENDPOINTS &&
+      hops < HAZCAT_GRAPH_MAX_ENDPOINTS; hops++, slot = g->endpoints[slot].next)
+    {
+      const graph_endpoint_t * endpoint = &g->endpoints[slot];
+      if (endpoint->kind != kind || endpoint->node < 0 ||
+        endpoint->node >= HAZCAT_GRAPH_MAX_NODES)
+      {
+        continue;
+      }
+      if (count < capacity) {
+        const graph_node_t * node = &g->nodes[endpoint->node];
+        endpoint_info_t * copy = &copies[count];
+        memcpy(copy->node_name, node->name, HAZCAT_GRAPH_NAME_MAX);
+        memcpy(copy->node_namespace, node->namespace_, HAZCAT_GRAPH_NAME_MAX);
+        memcpy(copy->type, endpoint->type, HAZCAT_GRAPH_NAME_MAX);
+        memcpy(copy->gid, endpoint->gid, RMW_GID_STORAGE_SIZE);
+        copy->qos = endpoint->qos;
+      }
+      count++;
+    }
+  } while (retry_read(g, seq));
+
+  return count;
+}
+
+rmw_ret_t
+hazcat_graph_get_endpoint_info(
+  const char * topic_name,
+  graph_endpoint_kind_t kind,
+  rcutils_allocator_t * allocator,
+  rmw_topic_endpoint_info_array_t * endpoints_info)
+{
+  graph_t * g;
+  rmw_ret_t ret = hazcat_graph_attach(&g);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+
+  // Most topics have a handful of endpoints, so start with room for a few on the stack, and only
+  // allocate if the topic turns out to have more
+  endpoint_info_t local[8];
+  endpoint_info_t * copies = local;
+  size_t capacity = sizeof(local) / sizeof(local[0]);
+  size_t count;
+  while ((count = copy_endpoints(g, topic_name, kind, copies, capacity)) > capacity) {
+    if (copies != local) {
+      rmw_free(copies);
+    }
+    capacity = count;
+    copies = rmw_allocate(capacity * sizeof(endpoint_info_t));
+    if (NULL == copies) {
+      RMW_SET_ERROR_MSG("Unable to allocate memory for endpoint info");
+      return RMW_RET_BAD_ALLOC;
+    }
+  }
+
+  if (0 == count) {
+    ret = RMW_RET_OK;
+    goto done;
+  }
+  ret = rmw_topic_endpoint_info_array_init_with_size(endpoints_info, count, allocator);
+  if (RMW_RET_OK != ret) {
+    goto done;
+  }
+  rmw_endpoint_type_t endpoint_type =
+    (GRAPH_PUBLISHER == kind) ? RMW_ENDPOINT_PUBLISHER : RMW_ENDPOINT_SUBSCRIPTION;
+  for (size_t i = 0; i < count; i++) {
+    rmw_topic_endpoint_info_t * info = &endpoints_info->info_array[i];
+    *info = rmw_get_zero_initialized_topic_endpoint_info();
+    if (RMW_RET_OK != (ret = rmw_topic_endpoint_info_set_node_name(
+        info, copies[i].node_name, allocator)) ||
+      RMW_RET_OK != (ret = rmw_topic_endpoint_info_set_node_namespace(
+        info, copies[i].node_namespace, allocator)) ||
+      RMW_RET_OK != (ret = rmw_topic_endpoint_info_set_topic_type(
+        info, copies[i].type, allocator)) ||
+      RMW_RET_OK != (ret = rmw_topic_endpoint_info_set_endpoint_type(info, endpoint_type)) ||
+      RMW_RET_OK != (ret = rmw_topic_endpoint_info_set_gid(
+        info, copies[i].gid, RMW_GID_STORAGE_SIZE)) ||
+      RMW_RET_OK != (ret = rmw_topic_endpoint_info_set_qos_profile(info, &copies[i].qos)))
+    {
+      rmw_topic_endpoint_info_array_fini(endpoints_info, allocator);
+      goto done;
+    }
+  }
+
+done:
+  if (copies != local) {
+    rmw_free(copies);
+  }
+  return ret;
+}
+
+// Private copy of the used slots of every table, for queries that look at the whole graph
+typedef struct graph_snapshot
+{
+  int32_t node_high;
+  int32_t topic_high;
+  int32_t endpoint_high;
+  graph_node_t * nodes;
+  graph_topic_t * topics;
+  graph_endpoint_t * endpoints;
+} graph_snapshot_t;
+
+static void
+free_snapshot(graph_snapshot_t * snap)
+{
+  rmw_free(snap->nodes);
+  rmw_free(snap->topics);
+  rmw_free(snap->endpoints);
+}
+
+static int32_t
+clamp_high(int32_t high, int32_t max)
+{
+  return (high < 0) ? 0 : (high > max) ? max : high;
+}
+
+static rmw_ret_t
+take_snapshot(graph_t * g, graph_snapshot_t * snap)
+{
+  int32_t node_capacity = 0, topic_capacity = 0, endpoint_capacity = 0;
+  memset(snap, 0, sizeof(graph_snapshot_t));
+  for (;;) {
+    uint32_t seq = begin_read(g);
+    snap->node_high = clamp_high(g->node_high, HAZCAT_GRAPH_MAX_NODES);
+    snap->topic_high = clamp_high(g->topic_high, HAZCAT_GRAPH_MAX_TOPICS);
+    snap->endpoint_high = clamp_high(g->endpoint_high, HAZCAT_GRAPH_MAX_ENDPOINTS);
+
+    // The graph grew since the buffers were sized. Make them as large as it is now, and start over
+    if (snap->node_high > node_capacity || snap->topic_high > topic_capacity ||
+      snap->endpoint_high > endpoint_capacity)
+    {
+      free_snapshot(snap);
+      node_capacity = snap->node_high;
+      topic_capacity = snap->topic_high;
+      endpoint_capacity = snap->endpoint_high;
+      snap->nodes = rmw_allocate((node_capacity + 1) * sizeof(graph_node_t));
+      snap->topics = rmw_allocate((topic_capacity + 1) * sizeof(graph_topic_t));
+      snap->endpoints = rmw_allocate((endpoint_capacity + 1) * sizeof(graph_endpoint_t));
+      if (NULL == snap->nodes || NULL == snap->topics || NULL == snap->endpoints) {
+        free_snapshot(snap);
+        RMW_SET_ERROR_MSG("Unable to allocate memory for ROS graph snapshot");
+        return RMW_RET_BAD_ALLOC;
+      }
+      continue;
+    }
+
+    memcpy(snap->nodes, g->nodes, snap->node_high * sizeof(graph_node_t));
+    memcpy(snap->topics, g->topics, snap->topic_high * sizeof(graph_topic_t));
+    memcpy(snap->endpoints, g->endpoints, snap->endpoint_high * sizeof(graph_endpoint_t));
+    if (!retry_read(g, seq)) {
+      return RMW_RET_OK;
+    }
+  }
+}
+
+rmw_ret_t
+hazcat_graph_get_node_names(
+  rcutils_string_array_t * node_names,
+  rcutils_string_array_t * node_namespaces,
+  rcutils_string_array_t * enclaves)
+{
+  graph_t * g;
+  graph_snapshot_t snap;
+  rmw_ret_t ret;
+  if (RMW_RET_OK != (ret = hazcat_graph_attach(&g)) ||
+    RMW_RET_OK != (ret = take_snapshot(g, &snap)))
+  {
+    return ret;
+  }
+
+  size_t count = 0;
+  for (int32_t slot = 0; slot < snap.node_high; slot++) {
+    if (0 != snap.nodes[slot].process.pid) {
+      count++;
+    }
+  }
+
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  if (RCUTILS_RET_OK != rcutils_string_array_init(node_names, count, &allocator) ||
+    RCUTILS_RET_OK != rcutils_string_array_init(node_namespaces, count, &allocator) ||
+    (NULL != enclaves &&
+    RCUTILS_RET_OK != rcutils_string_array_init(enclaves, count, &allocator)))
+  {
+    RMW_SET_ERROR_MSG("Unable to allocate memory for node names");
+    ret = RMW_RET_BAD_ALLOC;
+    goto fail;
+  }
+
+  size_t i = 0;
+  for (int32_t slot = 0; slot < snap.node_high; slot++) {
+    const graph_node_t * node = &snap.nodes[slot];
+    if (0 == node->process.pid) {
+      continue;
+    }
+    node_names->data[i] = rcutils_strdup(node->name, allocator);
+    node_namespaces->data[i] = rcutils_strdup(node->namespace_, allocator);
+    if (NULL == node_names->data[i] || NULL == node_namespaces->data[i]) {
+      RMW_SET_ERROR_MSG("Unable to allocate memory for node names");
+      ret = RMW_RET_BAD_ALLOC;
+      goto fail;
+    }
+    if (NULL != enclaves) {
+      enclaves->data[i] = rcutils_strdup(node->enclave, allocator);
+      if (NULL == enclaves->data[i]) {
+        RMW_SET_ERROR_MSG("Unable to allocate memory for enclaves");
+        ret = RMW_RET_BAD_ALLOC;
+        goto fail;
+      }
+    }
+    i++;
+  }
+
+  free_snapshot(&snap);
+  return RMW_RET_OK;
+
+fail:
+  rcutils_string_array_fini(node_names);
+  rcutils_string_array_fini(node_namespaces);
+  if (NULL != enclaves) {
+    rcutils_string_array_fini(enclaves);
+  }
+  free_snapshot(&snap);
+  return ret;
+}
+
+typedef struct name_and_type
+{
+  char name[HAZCAT_GRAPH_NAME_MAX];
+  char type[HAZCAT_GRAPH_NAME_MAX];
+} name_and_type_t;
+
+static int
+compare_names_and_types(const void * a, const void * b)
+{
+  const name_and_type_t * x = a;
+  const name_and_type_t * y = b;
+  int cmp = strcmp(x->name, y->name);
+  return (0 != cmp) ? cmp : strcmp(x->type, y->type);
+}
+
+static bool
+ends_with(const char * str, size_t len, const char * suffix)
+{
+  size_t suffix_len = strlen(suffix);
+  return len >= suffix_len && 0 == strcmp(str + len - suffix_len, suffix);
+}
+
+// Service name and type behind a request topic (see hazcat_request_topic) and its message type.
+// False if topic isn't one
+static bool
+demangle_service(const char * topic, const char * type, name_and_type_t * out)
+{
+  size_t topic_len = strlen(topic);
+  size_t type_len = strlen(type);
+  if (0 != strncmp(topic, "rq", 2) || !ends_with(topic, topic_len, "Request") ||
+    !ends_with(type, type_len, "_Request"))
+  {
+    return false;
+  }
+  snprintf(out->name, sizeof(out->name), "%.*s", (int)(topic_len - 2 - 7), topic + 2);
+  snprintf(out->type, sizeof(out->type), "%.*s", (int)(type_len - 8), type);
+  return true;
+}
+
+rmw_ret_t
+hazcat_graph_get_names_and_types(
+  const char * node_name,
+  const char * node_namespace,
+  uint32_t kinds,
+  bool services,
+  bool no_demangle,
+  rcutils_allocator_t * allocator,
+  rmw_names_and_types_t * names_and_types)
+{
+  graph_t * g;
+  graph_snapshot_t snap;
+  rmw_ret_t ret;
+  if (RMW_RET_OK != (ret = hazcat_graph_attach(&g)) ||
+    RMW_RET_OK != (ret = take_snapshot(g, &snap)))
+  {
+    return ret;
+  }
+
+  int32_t node_slot = -1;
+  if (NULL != node_name) {
+    for (int32_t slot = 0; slot < snap.node_high; slot++) {
+      const graph_node_t * node = &snap.nodes[slot];
+      if (0 != node->process.pid && 0 == strcmp(node->name, node_name) &&
+        0 == strcmp(node->namespace_, node_namespace))
+      {
+        node_slot = slot;
+        break;
+      }
+    }
+    if (-1 == node_slot) {
+      free_snapshot(&snap);
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
+        "Node %s in namespace %s doesn't exist", node_name, node_namespace);
+      return RMW_RET_NODE_NAME_NON_EXISTENT;
+    }
+  }
+
+  name_and_type_t * pairs = rmw_allocate((snap.endpoint_high + 1) * sizeof(name_and_type_t));
+  if (NULL == pairs) {
+    free_snapshot(&snap);
+    RMW_SET_ERROR_MSG("Unable to allocate memory for names and types");
+    return RMW_RET_BAD_ALLOC;
+  }
+
+  size_t count = 0;
+  for (int32_t slot = 0; slot < snap.endpoint_high; slot++) {
+    const graph_endpoint_t * endpoint = &snap.endpoints[slot];
+    if (0 == endpoint->process.pid || 0 == (endpoint->kind & kinds) ||
+      (-1 != node_slot && endpoint->node != node_slot) ||
+      endpoint->topic < 0 || endpoint->topic >= snap.topic_high)
+    {
+      continue;
+    }
+    const char * topic = snap.topics[endpoint->topic].name;
+    name_and_type_t * pair = &pairs[count];
+    if (services) {
+      if (!demangle_service(topic, endpoint->type, pair)) {
+        continue;
+      }
+    } else {
+      // ROS topics are fully qualified. Anything else is private to rmw_hazcat, or was created
+      // with avoid_ros_namespace_conventions
+      if (!no_demangle && '/' != topic[0]) {
+        continue;
+      }
+      snprintf(pair->name, sizeof(pair->name), "%s", topic);
+      snprintf(pair->type, sizeof(pair->type), "%s", endpoint->type);
+    }
+    count++;
+  }
+  free_snapshot(&snap);
+
+  // Sorted, each name's types are next to each other, and duplicates are too
+  qsort(pairs, count, sizeof(name_and_type_t), compare_names_and_types);
+  size_t unique = 0;
+  size_t names = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (0 == i || 0 != compare_names_and_types(&pairs[i], &pairs[unique - 1])) {
+      if (0 == i || 0 != strcmp(pairs[i].name, pairs[unique - 1].name)) {
+        names++;
+      }
+      pairs[unique++] = pairs[i];
+    }
+  }
+
+  if (0 == names) {
+    rmw_free(pairs);
+    return RMW_RET_OK;
+  }
+  ret = rmw_names_and_types_init(names_and_types, names, allocator);
+  if (RMW_RET_OK != ret) {
+    rmw_free(pairs);
+    return ret;
+  }
+  size_t first = 0;
+  for (size_t n = 0; n < names; n++) {
+    size_t last = first + 1;
+    while (last < unique && 0 == strcmp(pairs[last].name, pairs[first].name)) {
+      last++;
+    }
+    names_and_types->names.data[n] = rcutils_strdup(pairs[first].name, *allocator);
+    if (NULL == names_and_types->names.data[n] ||
+      RCUTILS_RET_OK != rcutils_string_array_init(
+        &names_and_types->types[n], last - first, allocator))
+    {
+      goto fail;
+    }
+    for (size_t i = first; i < last; i++) {
+      names_and_types->types[n].data[i - first] = rcutils_strdup(pairs[i].type, *allocator);
+      if (NULL == names_and_types->types[n].data[i - first]) {
+        goto fail;
+      }
+    }
+    first = last;
+  }
+
+  rmw_free(pairs);
+  return RMW_RET_OK;
+
+fail:
+  RMW_SET_ERROR_MSG("Unable to allocate memory for names and types");
+  rmw_names_and_types_fini(names_and_types);
+  rmw_free(pairs);
+  return RMW_RET_BAD_ALLOC;
+}
 
 #ifdef __cplusplus
 }
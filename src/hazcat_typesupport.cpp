@@ -12,6 +12,13 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <string>
+
+#include "rmw/allocators.h"
 #include "rmw/error_handling.h"
 #include "rmw/rmw.h"
 
@@ -22,36 +29,253 @@
 #include "rosidl_typesupport_introspection_c/field_types.h"
 #include "rosidl_typesupport_introspection_c/identifier.h"
 #include "rosidl_typesupport_introspection_c/message_introspection.h"
+#include "rosidl_typesupport_introspection_c/service_introspection.h"
 
 #include "rosidl_typesupport_introspection_cpp/field_types.hpp"
 #include "rosidl_typesupport_introspection_cpp/identifier.hpp"
 #include "rosidl_typesupport_introspection_cpp/message_introspection.hpp"
+#include "rosidl_typesupport_introspection_cpp/service_introspection.hpp"
+
+#include "rmw_hazcat/hazcat_typesupport.h"
 
 #define RMW_HAZCAT_TYPESUPPORT_C    rosidl_typesupport_introspection_c__identifier
 #define RMW_HAZCAT_TYPESUPPORT_CPP  rosidl_typesupport_introspection_cpp::typesupport_identifier
 
-extern "C"
-const rosidl_message_type_support_t *
-get_type_support(
-  const rosidl_message_type_support_t * type_support);
+namespace
+{
 
-const rosidl_message_type_support_t *
-get_type_support(
-  const rosidl_message_type_support_t * type_support)
+// Resolved types are kept in a hash table of lists keyed by the incoming handle's address. Nodes
+// are only ever pushed, never removed, so a lookup is a few acquire loads and never waits
+constexpr size_t kTypeCacheBuckets = 256;
+
+struct TypeCacheNode
+{
+  type_info_t info;
+  TypeCacheNode * next;
+};
+
+std::atomic<TypeCacheNode *> type_cache[kTypeCacheBuckets];
+
+// Services are cached the same way. Each node also holds the message handles it hands out
+struct ServiceCacheNode
 {
+  service_type_info_t info;
+  rosidl_message_type_support_t request;
+  rosidl_message_type_support_t response;
+  ServiceCacheNode * next;
+};
+
+std::atomic<ServiceCacheNode *> service_cache[kTypeCacheBuckets];
+
+// Whether a message of type members has no strings or sequences, at any depth
+template<typename MembersT>
+bool
+is_pod(const MembersT * members)
+{
+  for (uint32_t i = 0; i < members->member_count_; i++) {
+    const auto * member = members->members_ + i;
+    if (member->is_array_ && (0 == member->array_size_ || member->is_upper_bound_)) {
+      return false;
+    }
+    switch (member->type_id_) {
+      case rosidl_typesupport_introspection_c__ROS_TYPE_STRING:
+      case rosidl_typesupport_introspection_c__ROS_TYPE_WSTRING:
+        return false;
+      case rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE:
+        if (!is_pod(static_cast<const MembersT *>(member->members_->data))) {
+          return false;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return true;
+}
+
+// Turn the introspection namespace, "pkg__msg" in C or "pkg::msg" in C++, and name of a message
+// into its ROS type name, "pkg/msg/Name"
+void
+set_type_name(const char * ns, const char * separator, const char * name, type_info_t * info)
+{
+  std::string type_name(ns);
+  size_t separator_len = strlen(separator);
+  for (size_t pos = type_name.find(separator); std::string::npos != pos;
+    pos = type_name.find(separator, pos + 1))
+  {
+    type_name.replace(pos, separator_len, "/");
+  }
+  type_name += "/";
+  type_name += name;
+  snprintf(info->type_name, sizeof(info->type_name), "%s", type_name.c_str());
+}
+
+// Resolve type_support the slow way, through its dispatch function
+bool
+resolve(const rosidl_message_type_support_t * type_support, type_info_t * info)
+{
+  info->type_support = type_support;
+
   const rosidl_message_type_support_t * ts_c =
     reinterpret_cast<const rosidl_message_type_support_t *>(
     type_support->func(type_support, RMW_HAZCAT_TYPESUPPORT_C));
   if (ts_c) {
-    return ts_c;
+    auto members = static_cast<const rosidl_typesupport_introspection_c__MessageMembers *>(
+      ts_c->data);
+    info->introspection = ts_c;
+    info->is_cpp = false;
+    info->size = members->size_of_;
+    set_type_name(members->message_namespace_, "__", members->message_name_, info);
+    info->is_pod = is_pod(members);
+    return true;
   }
   const rosidl_message_type_support_t * ts_cpp =
     reinterpret_cast<const rosidl_message_type_support_t *>(
     type_support->func(type_support, RMW_HAZCAT_TYPESUPPORT_CPP));
   if (ts_cpp) {
-    return ts_cpp;
+    auto members = static_cast<const rosidl_typesupport_introspection_cpp::MessageMembers *>(
+      ts_cpp->data);
+    info->introspection = ts_cpp;
+    info->is_cpp = true;
+    info->size = members->size_of_;
+    set_type_name(members->message_namespace_, "::", members->message_name_, info);
+    info->is_pod = is_pod(members);
+    return true;
+  }
+
+  return false;
+}
+
+// Dispatch function of the message handles made up for service requests and responses. They only
+// answer to their own identifier
+const rosidl_message_type_support_t *
+own_handle(const rosidl_message_type_support_t * handle, const char * identifier)
+{
+  return (0 == strcmp(handle->typesupport_identifier, identifier)) ? handle : nullptr;
+}
+
+template<typename ServiceMembersT>
+void
+wrap_service(const ServiceMembersT * members, const char * identifier, ServiceCacheNode * node)
+{
+  node->request.typesupport_identifier = identifier;
+  node->request.data = members->request_members_;
+  node->request.func = own_handle;
+  node->response.typesupport_identifier = identifier;
+  node->response.data = members->response_members_;
+  node->response.func = own_handle;
+  node->info.request = &node->request;
+  node->info.response = &node->response;
+}
+
+bool
+resolve_service(const rosidl_service_type_support_t * type_support, ServiceCacheNode * node)
+{
+  node->info.type_support = type_support;
+
+  const rosidl_service_type_support_t * ts_c = type_support->func(
+    type_support, RMW_HAZCAT_TYPESUPPORT_C);
+  if (ts_c) {
+    wrap_service(
+      static_cast<const rosidl_typesupport_introspection_c__ServiceMembers *>(ts_c->data),
+      RMW_HAZCAT_TYPESUPPORT_C, node);
+    return true;
+  }
+  const rosidl_service_type_support_t * ts_cpp = type_support->func(
+    type_support, RMW_HAZCAT_TYPESUPPORT_CPP);
+  if (ts_cpp) {
+    wrap_service(
+      static_cast<const rosidl_typesupport_introspection_cpp::ServiceMembers *>(ts_cpp->data),
+      RMW_HAZCAT_TYPESUPPORT_CPP, node);
+    return true;
+  }
+
+  return false;
+}
+
+}  // namespace
+
+const type_info_t *
+hazcat_type_info(const rosidl_message_type_support_t * type_support)
+{
+  std::atomic<TypeCacheNode *> & bucket =
+    type_cache[(reinterpret_cast<uintptr_t>(type_support) >> 4) % kTypeCacheBuckets];
+  TypeCacheNode * head = bucket.load(std::memory_order_acquire);
+  for (TypeCacheNode * node = head; nullptr != node; node = node->next) {
+    if (node->info.type_support == type_support) {
+      return &node->info;
+    }
+  }
+
+  TypeCacheNode * node = static_cast<TypeCacheNode *>(rmw_allocate(sizeof(TypeCacheNode)));
+  if (nullptr == node) {
+    RMW_SET_ERROR_MSG("Unable to allocate memory for type info");
+    return nullptr;
+  }
+  if (!resolve(type_support, &node->info)) {
+    rmw_free(node);
+    RMW_SET_ERROR_MSG("Unsupported typesupport");
+    return nullptr;
   }
 
-  RMW_SET_ERROR_MSG("Unsupported typesupport");
-  return nullptr;
+  // Push it, unless another thread resolved the same handle in the meantime
+  node->next = head;
+  while (!bucket.compare_exchange_weak(
+      node->next, node, std::memory_order_acq_rel, std::memory_order_acquire))
+  {
+    for (TypeCacheNode * other = node->next; other != head; other = other->next) {
+      if (other->info.type_support == type_support) {
+        rmw_free(node);
+        return &other->info;
+      }
+    }
+    head = node->next;
+  }
+  return &node->info;
+}
+
+const rosidl_message_type_support_t *
+get_type_support(
+  const rosidl_message_type_support_t * type_support)
+{
+  const type_info_t * info = hazcat_type_info(type_support);
+  return (nullptr != info) ? info->introspection : nullptr;
+}
+
+const service_type_info_t *
+hazcat_service_type_info(const rosidl_service_type_support_t * type_support)
+{
+  std::atomic<ServiceCacheNode *> & bucket =
+    service_cache[(reinterpret_cast<uintptr_t>(type_support) >> 4) % kTypeCacheBuckets];
+  ServiceCacheNode * head = bucket.load(std::memory_order_acquire);
+  for (ServiceCacheNode * node = head; nullptr != node; node = node->next) {
+    if (node->info.type_support == type_support) {
+      return &node->info;
+    }
+  }
+
+  ServiceCacheNode * node = static_cast<ServiceCacheNode *>(rmw_allocate(sizeof(ServiceCacheNode)));
+  if (nullptr == node) {
+    RMW_SET_ERROR_MSG("Unable to allocate memory for service type info");
+    return nullptr;
+  }
+  if (!resolve_service(type_support, node)) {
+    rmw_free(node);
+    RMW_SET_ERROR_MSG("Unsupported service typesupport");
+    return nullptr;
+  }
+
+  node->next = head;
+  while (!bucket.compare_exchange_weak(
+      node->next, node, std::memory_order_acq_rel, std::memory_order_acquire))
+  {
+    for (ServiceCacheNode * other = node->next; other != head; other = other->next) {
+      if (other->info.type_support == type_support) {
+        rmw_free(node);
+        return &other->info;
+      }
+    }
+    head = node->next;
+  }
+  return &node->info;
 }
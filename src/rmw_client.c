@@ -21,6 +21,11 @@
 
 #include "hazcat/hazcat_message_queue.h"
 
+#include "rmw_hazcat/hazcat_publisher.h"
+#include "rmw_hazcat/hazcat_service.h"
+#include "rmw_hazcat/hazcat_subscription.h"
+#include "rmw_hazcat/hazcat_typesupport.h"
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -56,23 +61,79 @@ rmw_create_client(
     return NULL;
   }
 
+  const service_type_info_t * types = hazcat_service_type_info(type_support);
+  if (NULL == types) {
+    return NULL;
+  }
+
   rmw_client_t * clt = rmw_client_allocate();
   if (NULL == clt) {
     RMW_SET_ERROR_MSG("Unable to allocate memory for service");
     return NULL;
   }
+  client_info_t * info = rmw_allocate(sizeof(client_info_t));
+  if (NULL == info) {
+    RMW_SET_ERROR_MSG("Unable to allocate memory for client info");
+    rmw_client_free(clt);
+    return NULL;
+  }
+  info->requests = NULL;
+  info->responses = NULL;
+  info->sequence_number = 0;
+
+  // The endpoints' topics are private, and deliberately not valid ROS names
+  rmw_qos_profile_t qos = *qos_policies;
+  qos.avoid_ros_namespace_conventions = true;
+
+  char * topic = hazcat_request_topic(service_name);
+  if (NULL == topic) {
+    RMW_SET_ERROR_MSG("Unable to allocate string for request topic");
+    goto fail;
+  }
+  rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+  info->requests = rmw_create_publisher(node, types->request, topic, &qos, &pub_options);
+  rmw_free(topic);
+  if (NULL == info->requests) {
+    goto fail;
+  }
+  memcpy(&info->gid, ((pub_sub_data_t *)info->requests->data)->gid.data, sizeof(gid_layout_t));
+
+  // Subscribe for responses before any request can go out, so none are missed
+  topic = hazcat_response_topic(service_name, &info->gid);
+  if (NULL == topic) {
+    RMW_SET_ERROR_MSG("Unable to allocate string for response topic");
+    goto fail;
+  }
+  rmw_subscription_options_t sub_options = rmw_get_default_subscription_options();
+  info->responses = rmw_create_subscription(node, types->response, topic, &qos, &sub_options);
+  rmw_free(topic);
+  if (NULL == info->responses) {
+    goto fail;
+  }
+  ((subscription_info_t *)info->responses->data)->count_lost = false;
 
   clt->implementation_identifier = rmw_get_implementation_identifier();
-  clt->data = rmw_allocate(sizeof(srv_clt_data_t));
+  clt->data = info;
   clt->service_name = rmw_allocate(strlen(service_name) + 1);
 
   if (NULL == clt->service_name) {
-    RMW_SET_ERROR_MSG("Unable to allocate string for subscription's topic name");
-    return NULL;
+    RMW_SET_ERROR_MSG("Unable to allocate string for client's service name");
+    goto fail;
   }
   snprintf(clt->service_name, strlen(service_name) + 1, service_name);
 
   return clt;
+
+fail:
+  if (NULL != info->responses) {
+    rmw_destroy_subscription((rmw_node_t *)node, info->responses);
+  }
+  if (NULL != info->requests) {
+    rmw_destroy_publisher((rmw_node_t *)node, info->requests);
+  }
+  rmw_free(info);
+  rmw_client_free(clt);
+  return NULL;
 }
 
 rmw_ret_t
@@ -87,11 +148,18 @@ rmw_destroy_client(rmw_node_t * node, rmw_client_t * client)
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
 
-  rmw_free(client->data);
+  client_info_t * info = client->data;
+  rmw_ret_t ret = rmw_destroy_subscription(node, info->responses);
+  rmw_ret_t pub_ret = rmw_destroy_publisher(node, info->requests);
+  if (RMW_RET_OK == ret) {
+    ret = pub_ret;
+  }
+
+  rmw_free(info);
   rmw_free(client->service_name);
   rmw_client_free(client);
 
-  return RMW_RET_OK;
+  return ret;
 }
 
 rmw_ret_t
@@ -103,9 +171,14 @@ rmw_send_request(
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(client, RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(ros_request, RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(sequence_id, RMW_RET_INVALID_ARGUMENT);
+  if (client->implementation_identifier != rmw_get_implementation_identifier()) {
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
+  }
+
+  client_info_t * info = client->data;
+  *sequence_id = __atomic_add_fetch(&info->sequence_number, 1, __ATOMIC_RELAXED);
 
-  RMW_SET_ERROR_MSG("rmw_send_request hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  return hazcat_publisher_publish(info->requests, ros_request, (uint64_t)*sequence_id);
 }
 
 rmw_ret_t
@@ -119,9 +192,25 @@ rmw_take_response(
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(request_header, RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(ros_response, RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(taken, RMW_RET_INVALID_ARGUMENT);
+  if (client->implementation_identifier != rmw_get_implementation_identifier()) {
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
+  }
 
-  RMW_SET_ERROR_MSG("rmw_take_response hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  client_info_t * info = client->data;
+  rmw_message_info_t message_info;
+  rmw_ret_t ret = rmw_take_with_info(info->responses, ros_response, taken, &message_info, NULL);
+  if (RMW_RET_OK != ret || !*taken) {
+    return ret;
+  }
+
+  // Responses carry the sequence number of the request they answer
+  request_header->source_timestamp = message_info.source_timestamp;
+  request_header->received_timestamp = message_info.received_timestamp;
+  memset(request_header->request_id.writer_guid, 0, sizeof(request_header->request_id.writer_guid));
+  memcpy(request_header->request_id.writer_guid, &info->gid, sizeof(gid_layout_t));
+  request_header->request_id.sequence_number = (int64_t)message_info.publication_sequence_number;
+
+  return RMW_RET_OK;
 }
 
 #ifdef __cplusplus
@@ -25,11 +25,14 @@
 #include "rmw/get_topic_names_and_types.h"
 #include "rmw/names_and_types.h"
 #include "rmw/sanity_checks.h"
+#include "rmw/validate_full_topic_name.h"
 #include "rmw/validate_namespace.h"
 #include "rmw/validate_node_name.h"
 
 #include "hazcat/hazcat_message_queue.h"
 
+#include "rmw_hazcat/hazcat_ros_graph.h"
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -46,19 +49,18 @@ rmw_count_publishers(
   if (node->implementation_identifier != rmw_get_implementation_identifier()) {
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
-  int validation_result = RMW_NODE_NAME_VALID;
-  rmw_ret_t ret = rmw_validate_node_name(topic_name, &validation_result, NULL);
+  int validation_result = RMW_TOPIC_VALID;
+  rmw_ret_t ret = rmw_validate_full_topic_name(topic_name, &validation_result, NULL);
   if (RMW_RET_OK != ret) {
     return ret;
   }
-  if (RMW_NODE_NAME_VALID != validation_result) {
-    const char * reason = rmw_node_name_validation_result_string(validation_result);
-    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("node_name argument is invalid: %s", reason);
+  if (RMW_TOPIC_VALID != validation_result) {
+    const char * reason = rmw_full_topic_name_validation_result_string(validation_result);
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("topic_name argument is invalid: %s", reason);
     return RMW_RET_INVALID_ARGUMENT;
   }
 
-  RMW_SET_ERROR_MSG("rmw_count_publishers hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  return hazcat_graph_count(topic_name, count, NULL);
 }
 
 rmw_ret_t
@@ -73,19 +75,18 @@ rmw_count_subscribers(
   if (node->implementation_identifier != rmw_get_implementation_identifier()) {
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
-  int validation_result = RMW_NODE_NAME_VALID;
-  rmw_ret_t ret = rmw_validate_node_name(topic_name, &validation_result, NULL);
+  int validation_result = RMW_TOPIC_VALID;
+  rmw_ret_t ret = rmw_validate_full_topic_name(topic_name, &validation_result, NULL);
   if (RMW_RET_OK != ret) {
     return ret;
   }
-  if (RMW_NODE_NAME_VALID != validation_result) {
-    const char * reason = rmw_node_name_validation_result_string(validation_result);
-    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("node_name argument is invalid: %s", reason);
+  if (RMW_TOPIC_VALID != validation_result) {
+    const char * reason = rmw_full_topic_name_validation_result_string(validation_result);
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("topic_name argument is invalid: %s", reason);
     return RMW_RET_INVALID_ARGUMENT;
   }
 
-  RMW_SET_ERROR_MSG("rmw_count_subscribers hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  return hazcat_graph_count(topic_name, NULL, count);
 }
 
 rmw_ret_t
@@ -99,7 +100,9 @@ rmw_subscription_count_matched_publishers(
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
 
-  *publisher_count = ((pub_sub_data_t *)subscription->data)->mq->elem->pub_count;
+  // Straight from the topic's message queue, which every process on it shares
+  *publisher_count =
+    __atomic_load_n(&((pub_sub_data_t *)subscription->data)->mq->elem->pub_count, __ATOMIC_ACQUIRE);
 
   return RMW_RET_OK;
 }
@@ -115,7 +118,8 @@ rmw_publisher_count_matched_subscriptions(
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
 
-  *subscription_count = ((pub_sub_data_t *)publisher->data)->mq->elem->sub_count;
+  *subscription_count =
+    __atomic_load_n(&((pub_sub_data_t *)publisher->data)->mq->elem->sub_count, __ATOMIC_ACQUIRE);
 
   return RMW_RET_OK;
 }
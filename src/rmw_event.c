@@ -12,14 +12,267 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <stdio.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
 #include "rcutils/error_handling.h"
+#include "rmw/error_handling.h"
 #include "rmw/event.h"
 #include "rmw/rmw.h"
 
+#include "rmw_hazcat/hazcat_event.h"
+#include "rmw_hazcat/hazcat_publisher.h"
+#include "rmw_hazcat/hazcat_ros_graph.h"
+#include "rmw_hazcat/hazcat_subscription.h"
+#include "rmw_hazcat/hazcat_wait_set.h"
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
+
+#define NS_PER_SEC 1000000000
+
+int64_t
+hazcat_duration_ns(rmw_time_t duration)
+{
+  // Infinite durations are the largest that fit in 64 bits of nanoseconds
+  if (duration.sec >= INT64_MAX / NS_PER_SEC) {
+    return 0;
+  }
+  return (int64_t)duration.sec * NS_PER_SEC + (int64_t)duration.nsec;
+}
+
+int64_t
+hazcat_monotonic_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+// Make fd fire at when, in CLOCK_MONOTONIC nanoseconds. A time already past fires right away, and
+// 0 disarms it
+static void
+arm_timer(int fd, int64_t when)
+{
+  struct itimerspec its = {
+    .it_interval = {0, 0},
+    .it_value = {when / NS_PER_SEC, when % NS_PER_SEC}
+  };
+  if (-1 == timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, NULL)) {
+    perror("timerfd_settime: ");
+  }
+}
+
+void
+hazcat_event_timer_init(
+  event_timer_t * timer, rmw_event_type_t type, const void * entity, int64_t period)
+{
+  timer->fd = -1;
+  timer->type = type;
+  timer->entity = entity;
+  timer->period = period;
+  // Publishers are alive from the start. Deadlines start with the first message
+  timer->start = (RMW_EVENT_LIVELINESS_LOST == type && 0 != period) ? hazcat_monotonic_now() : 0;
+  timer->count = 0;
+  timer->alive = 0;
+  timer->not_alive = 0;
+  timer->count_reported = 0;
+  timer->alive_reported = 0;
+  timer->not_alive_reported = 0;
+}
+
+void
+hazcat_event_timer_fini(event_timer_t * timer)
+{
+  if (-1 != timer->fd) {
+    if (RMW_EVENT_LIVELINESS_CHANGED == timer->type) {
+      hazcat_graph_unwatch_timer(timer->fd);
+    }
+    close(timer->fd);
+    timer->fd = -1;
+    hazcat_wait_set_invalidate();
+  }
+}
+
+// Create timer's fd, if it doesn't have one yet, and arm it for its first check
+static rmw_ret_t
+start_timer(event_timer_t * timer)
+{
+  bool on = 0 != timer->period || RMW_EVENT_LIVELINESS_CHANGED == timer->type;
+  if (!on || -1 != __atomic_load_n(&timer->fd, __ATOMIC_SEQ_CST)) {
+    return RMW_RET_OK;
+  }
+  int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (-1 == fd) {
+    RMW_SET_ERROR_MSG("Unable to create timer for event");
+    return RMW_RET_ERROR;
+  }
+  int expected = -1;
+  if (!__atomic_compare_exchange_n(
+      &timer->fd, &expected, fd, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+  {
+    close(fd);
+    return RMW_RET_OK;
+  }
+
+  if (RMW_EVENT_LIVELINESS_CHANGED == timer->type) {
+    rmw_ret_t ret = hazcat_graph_watch_timer(fd);
+    if (RMW_RET_OK != ret) {
+      __atomic_store_n(&timer->fd, -1, __ATOMIC_SEQ_CST);
+      close(fd);
+      return ret;
+    }
+    // Count the publishers already there right away
+    arm_timer(fd, hazcat_monotonic_now());
+  } else {
+    // Otherwise the first message or assertion arms it, unless there's been one already
+    int64_t start = __atomic_load_n(&timer->start, __ATOMIC_SEQ_CST);
+    if (0 != start) {
+      arm_timer(fd, start + timer->period);
+    }
+  }
+  return RMW_RET_OK;
+}
+
+void
+hazcat_event_timer_restart(event_timer_t * timer, int64_t now)
+{
+  // The timer only stops when there was nothing to wait for, so only then does it need arming
+  if (0 == __atomic_exchange_n(&timer->start, now, __ATOMIC_SEQ_CST)) {
+    int fd = __atomic_load_n(&timer->fd, __ATOMIC_SEQ_CST);
+    if (-1 != fd) {
+      arm_timer(fd, now + timer->period);
+    }
+  }
+}
+
+// Count every whole deadline that passed since the last message, and wait for the next one
+static void
+check_deadline(event_timer_t * timer, int64_t now)
+{
+  int64_t start = __atomic_load_n(&timer->start, __ATOMIC_SEQ_CST);
+  if (0 == start) {
+    return;
+  }
+  if (now - start >= timer->period) {
+    int64_t missed = (now - start) / timer->period;
+    // A message that arrived meanwhile moved start, and nothing was missed after all
+    if (__atomic_compare_exchange_n(
+        &timer->start, &start, start + missed * timer->period, false, __ATOMIC_SEQ_CST,
+        __ATOMIC_SEQ_CST))
+    {
+      __atomic_fetch_add(&timer->count, (int32_t)missed, __ATOMIC_RELEASE);
+      start += missed * timer->period;
+    }
+  }
+  arm_timer(timer->fd, start + timer->period);
+}
+
+// Declare the publisher's liveliness lost if its lease ran out. The timer stays off until the
+// next assertion restarts it
+static void
+check_lease(event_timer_t * timer, int64_t now)
+{
+  int64_t start = __atomic_load_n(&timer->start, __ATOMIC_SEQ_CST);
+  if (0 == start) {
+    return;
+  }
+  if (now - start >= timer->period) {
+    if (__atomic_compare_exchange_n(
+        &timer->start, &start, 0, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+    {
+      __atomic_fetch_add(&timer->count, 1, __ATOMIC_RELEASE);
+      return;
+    }
+  }
+  arm_timer(timer->fd, start + timer->period);
+}
+
+// Count the live publishers on the subscription's topic, and wait until one's lease might run out.
+// Publishers coming, going or coming back to life change the graph, whose watcher fires the timer
+static void
+check_liveliness(event_timer_t * timer, int64_t now)
+{
+  const rmw_subscription_t * subscription = timer->entity;
+  graph_t * g;
+  if (RMW_RET_OK != hazcat_graph_attach(&g)) {
+    rmw_reset_error();
+    return;
+  }
+  uint32_t generation = __atomic_load_n(&g->generation, __ATOMIC_ACQUIRE);
+  int32_t alive, not_alive;
+  int64_t expiry = 0;
+  if (RMW_RET_OK == hazcat_graph_count_alive(
+      subscription->topic_name, now, &alive, &not_alive, &expiry))
+  {
+    __atomic_store_n(&timer->alive, alive, __ATOMIC_RELEASE);
+    __atomic_store_n(&timer->not_alive, not_alive, __ATOMIC_RELEASE);
+  } else {
+    rmw_reset_error();
+  }
+  // Disarmed if no lease can run out
+  arm_timer(timer->fd, expiry);
+  // Arming discards a firing the watcher made for a change the count above may have missed
+  if (__atomic_load_n(&g->generation, __ATOMIC_ACQUIRE) != generation) {
+    arm_timer(timer->fd, now);
+  }
+}
+
+void
+hazcat_event_check(event_timer_t * timer)
+{
+  uint64_t expirations;
+  if (-1 == read(timer->fd, &expirations, sizeof(expirations))) {
+    // Another wait set got to it first
+    return;
+  }
+
+  int64_t now = hazcat_monotonic_now();
+  switch (timer->type) {
+    case RMW_EVENT_REQUESTED_DEADLINE_MISSED: {
+        // Messages still waiting to be taken arrived in time as far as anyone can tell
+        const pub_sub_data_t * sub = ((const rmw_subscription_t *)timer->entity)->data;
+        if (sub->next_index != __atomic_load_n(&sub->mq->elem->index, __ATOMIC_ACQUIRE)) {
+          hazcat_event_timer_restart(timer, now);
+        }
+        check_deadline(timer, now);
+        break;
+      }
+    case RMW_EVENT_OFFERED_DEADLINE_MISSED:
+      check_deadline(timer, now);
+      break;
+    case RMW_EVENT_LIVELINESS_LOST:
+      check_lease(timer, now);
+      break;
+    case RMW_EVENT_LIVELINESS_CHANGED:
+      check_liveliness(timer, now);
+      break;
+    default:
+      break;
+  }
+}
+
+event_timer_t *
+hazcat_event_timer(const rmw_event_t * event)
+{
+  switch (event->event_type) {
+    case RMW_EVENT_OFFERED_DEADLINE_MISSED:
+      return &((publisher_info_t *)((const rmw_publisher_t *)event->data)->data)->deadline;
+    case RMW_EVENT_LIVELINESS_LOST:
+      return &((publisher_info_t *)((const rmw_publisher_t *)event->data)->data)->liveliness;
+    case RMW_EVENT_REQUESTED_DEADLINE_MISSED:
+      return &((subscription_info_t *)((const rmw_subscription_t *)event->data)->data)->deadline;
+    case RMW_EVENT_LIVELINESS_CHANGED:
+      return &((subscription_info_t *)((const rmw_subscription_t *)event->data)->data)->liveliness;
+    default:
+      return NULL;
+  }
+}
+
 rmw_ret_t
 rmw_publisher_event_init(
   rmw_event_t * rmw_event,
@@ -28,13 +281,19 @@ rmw_publisher_event_init(
 {
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(rmw_event, RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(publisher, RMW_RET_INVALID_ARGUMENT);
+  if (publisher->implementation_identifier != rmw_get_implementation_identifier()) {
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
+  }
+  if (RMW_EVENT_OFFERED_DEADLINE_MISSED != event_type && RMW_EVENT_LIVELINESS_LOST != event_type) {
+    RMW_SET_ERROR_MSG("Publisher event type not supported by rmw_hazcat");
+    return RMW_RET_UNSUPPORTED;
+  }
 
   rmw_event->event_type = event_type;
-  rmw_event->implementation_identifier = rmw_get_implementation_identifier;
-  rmw_event->data = publisher;
+  rmw_event->implementation_identifier = rmw_get_implementation_identifier();
+  rmw_event->data = (void *)publisher;
 
-  /// @todo add publisher events support
-  return RMW_RET_OK;
+  return start_timer(hazcat_event_timer(rmw_event));
 }
 
 rmw_ret_t
@@ -45,12 +304,111 @@ rmw_subscription_event_init(
 {
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(rmw_event, RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(subscription, RMW_RET_INVALID_ARGUMENT);
+  if (subscription->implementation_identifier != rmw_get_implementation_identifier()) {
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
+  }
+  if (RMW_EVENT_MESSAGE_LOST != event_type &&
+    RMW_EVENT_REQUESTED_DEADLINE_MISSED != event_type &&
+    RMW_EVENT_LIVELINESS_CHANGED != event_type)
+  {
+    RMW_SET_ERROR_MSG("Subscription event type not supported by rmw_hazcat");
+    return RMW_RET_UNSUPPORTED;
+  }
 
   rmw_event->event_type = event_type;
-  rmw_event->implementation_identifier = rmw_get_implementation_identifier;
-  rmw_event->data = subscription;
+  rmw_event->implementation_identifier = rmw_get_implementation_identifier();
+  rmw_event->data = (void *)subscription;
+
+  event_timer_t * timer = hazcat_event_timer(rmw_event);
+  return (NULL != timer) ? start_timer(timer) : RMW_RET_OK;
+}
+
+// Whether value moved on since it was last reported
+static inline bool
+changed(const int32_t * value, const int32_t * reported)
+{
+  return __atomic_load_n(value, __ATOMIC_ACQUIRE) != __atomic_load_n(reported, __ATOMIC_ACQUIRE);
+}
+
+// Report value, returning how much it changed since it was last reported
+static inline int32_t
+report(const int32_t * value, int32_t * reported, int32_t * total)
+{
+  *total = __atomic_load_n(value, __ATOMIC_ACQUIRE);
+  return *total - __atomic_exchange_n(reported, *total, __ATOMIC_ACQ_REL);
+}
+
+bool
+hazcat_event_is_ready(const rmw_event_t * event)
+{
+  if (RMW_EVENT_MESSAGE_LOST == event->event_type) {
+    subscription_info_t * info = ((const rmw_subscription_t *)event->data)->data;
+    return __atomic_load_n(&info->lost, __ATOMIC_ACQUIRE) !=
+           __atomic_load_n(&info->lost_reported, __ATOMIC_ACQUIRE);
+  }
+  event_timer_t * timer = hazcat_event_timer(event);
+  if (NULL == timer) {
+    return false;
+  }
+  return changed(&timer->count, &timer->count_reported) ||
+         changed(&timer->alive, &timer->alive_reported) ||
+         changed(&timer->not_alive, &timer->not_alive_reported);
+}
+
+rmw_ret_t
+rmw_take_event(const rmw_event_t * event_handle, void * event_info, bool * taken)
+{
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(event_handle, RMW_RET_INVALID_ARGUMENT);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(event_info, RMW_RET_INVALID_ARGUMENT);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(taken, RMW_RET_INVALID_ARGUMENT);
+  if (event_handle->implementation_identifier != rmw_get_implementation_identifier()) {
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
+  }
+
+  event_timer_t * timer = hazcat_event_timer(event_handle);
+  switch (event_handle->event_type) {
+    case RMW_EVENT_MESSAGE_LOST: {
+        subscription_info_t * info = ((const rmw_subscription_t *)event_handle->data)->data;
+        uint64_t lost = __atomic_load_n(&info->lost, __ATOMIC_ACQUIRE);
+        uint64_t reported = __atomic_exchange_n(&info->lost_reported, lost, __ATOMIC_ACQ_REL);
+        rmw_message_lost_status_t * status = event_info;
+        status->total_count = lost;
+        status->total_count_change = lost - reported;
+        break;
+      }
+    case RMW_EVENT_OFFERED_DEADLINE_MISSED: {
+        rmw_offered_deadline_missed_status_t * status = event_info;
+        status->total_count_change =
+          report(&timer->count, &timer->count_reported, &status->total_count);
+        break;
+      }
+    case RMW_EVENT_REQUESTED_DEADLINE_MISSED: {
+        rmw_requested_deadline_missed_status_t * status = event_info;
+        status->total_count_change =
+          report(&timer->count, &timer->count_reported, &status->total_count);
+        break;
+      }
+    case RMW_EVENT_LIVELINESS_LOST: {
+        rmw_liveliness_lost_status_t * status = event_info;
+        status->total_count_change =
+          report(&timer->count, &timer->count_reported, &status->total_count);
+        break;
+      }
+    case RMW_EVENT_LIVELINESS_CHANGED: {
+        rmw_liveliness_changed_status_t * status = event_info;
+        status->alive_count_change =
+          report(&timer->alive, &timer->alive_reported, &status->alive_count);
+        status->not_alive_count_change =
+          report(&timer->not_alive, &timer->not_alive_reported, &status->not_alive_count);
+        break;
+      }
+    default:
+      *taken = false;
+      RMW_SET_ERROR_MSG("Event type not supported by rmw_hazcat");
+      return RMW_RET_UNSUPPORTED;
+  }
 
-  /// @todo add subscription events support
+  *taken = true;
   return RMW_RET_OK;
 }
 #ifdef __cplusplus
@@ -14,7 +14,7 @@
 
 #include "rmw/rmw.h"
 
-const char * const hazcat_serialization_format = "shared_memory";
+const char * const hazcat_serialization_format = "cdr";
 
 #ifdef __cplusplus
 extern "C"
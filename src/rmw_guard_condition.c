@@ -13,19 +13,35 @@
 // limitations under the License.
 
 #include <stdatomic.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 #include "rmw/allocators.h"
 #include "rmw/error_handling.h"
 #include "rmw/rmw.h"
 
-#include "hazcat/types.h"
-#include "hazcat/guard_condition.h"
+#include "rmw_hazcat/hazcat_guard_condition.h"
+#include "rmw_hazcat/hazcat_wait_set.h"
 
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+uint64_t
+hazcat_guard_condition_take(guard_condition_info_t * gc)
+{
+  uint32_t pending = __atomic_exchange_n(&gc->pending, 0, __ATOMIC_ACQ_REL);
+
+  // Always read, even if pending was already clear. A trigger racing with the last take may have
+  // set pending after it was cleared, but written to the eventfd after it was read
+  uint64_t count;
+  if (read(gc->fd, &count, sizeof(count)) != sizeof(count)) {
+    count = 0;
+  }
+  return (0 == count && 0 != pending) ? 1 : count;
+}
+
 // Creates guard condition
 rmw_guard_condition_t *
 rmw_create_guard_condition(
@@ -41,8 +57,20 @@ rmw_create_guard_condition(
   guard->implementation_identifier = rmw_get_implementation_identifier();
   guard->context = context;
 
-  guard_condition_t * gc_impl = rmw_allocate(sizeof(guard_condition_t));
-  create_guard_condition_impl(gc_impl);
+  guard_condition_info_t * gc_impl = rmw_allocate(sizeof(guard_condition_info_t));
+  if (NULL == gc_impl) {
+    RMW_SET_ERROR_MSG("failed to allocate memory for guard condition");
+    rmw_guard_condition_free(guard);
+    return NULL;
+  }
+  gc_impl->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (-1 == gc_impl->fd) {
+    RMW_SET_ERROR_MSG("failed to create eventfd for guard condition");
+    rmw_free(gc_impl);
+    rmw_guard_condition_free(guard);
+    return NULL;
+  }
+  gc_impl->pending = 0;
   guard->data = gc_impl;
 
   return guard;
@@ -54,9 +82,10 @@ rmw_destroy_guard_condition(
 {
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(guard_condition, RMW_RET_INVALID_ARGUMENT);
 
-  guard_condition_t * gc = (guard_condition_t *)guard_condition->data;
+  guard_condition_info_t * gc = (guard_condition_info_t *)guard_condition->data;
 
-  destroy_guard_condition_impl(gc);
+  close(gc->fd);
+  hazcat_wait_set_invalidate();
   rmw_free(guard_condition->data);
   rmw_free(guard_condition);
 
@@ -71,10 +100,11 @@ rmw_trigger_guard_condition(
 {
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(guard_condition, RMW_RET_INVALID_ARGUMENT);
 
-  // Write one byte to the pipe owned by guard condition, sending a signal to anyone waiting on it
-  guard_condition_t * gc = guard_condition->data;
-  uint8_t dummy = 0x1;
-  if (write(gc->pfd[1], &dummy, 1) < 1) {
+  // Add one to the eventfd owned by guard condition, waking anyone waiting on it
+  guard_condition_info_t * gc = guard_condition->data;
+  __atomic_store_n(&gc->pending, 1, __ATOMIC_RELEASE);
+  uint64_t one = 1;
+  if (write(gc->fd, &one, sizeof(one)) != sizeof(one)) {
     RMW_SET_ERROR_MSG("Error triggering guard condition");
     return RMW_RET_ERROR;
   }
@@ -20,6 +20,8 @@
 
 #include "hazcat/hazcat_message_queue.h"
 
+#include "rmw_hazcat/hazcat_init_options.h"
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -69,10 +71,19 @@ rmw_init_options_copy(const rmw_init_options_t * src, rmw_init_options_t * dst)
   if (NULL != src->enclave && NULL == tmp.enclave) {
     return RMW_RET_BAD_ALLOC;
   }
+  if (NULL != src->impl) {
+    tmp.impl = allocator->allocate(sizeof(init_options_impl_t), allocator->state);
+    if (NULL == tmp.impl) {
+      allocator->deallocate(tmp.enclave, allocator->state);
+      return RMW_RET_BAD_ALLOC;
+    }
+    *(init_options_impl_t *)tmp.impl = *(const init_options_impl_t *)src->impl;
+  }
   tmp.security_options = rmw_get_zero_initialized_security_options();
   rmw_ret_t ret =
     rmw_security_options_copy(&src->security_options, allocator, &tmp.security_options);
   if (RMW_RET_OK != ret) {
+    allocator->deallocate(tmp.impl, allocator->state);
     allocator->deallocate(tmp.enclave, allocator->state);
     return ret;
   }
@@ -97,12 +108,39 @@ rmw_init_options_fini(rmw_init_options_t * init_options)
   rcutils_allocator_t * allocator = &init_options->allocator;
   RCUTILS_CHECK_ALLOCATOR(allocator, return RMW_RET_INVALID_ARGUMENT);
 
+  allocator->deallocate(init_options->impl, allocator->state);
   allocator->deallocate(init_options->enclave, allocator->state);
   rmw_ret_t ret = rmw_security_options_fini(&init_options->security_options, allocator);
   *init_options = rmw_get_zero_initialized_init_options();
   return ret;
 }
 
+rmw_ret_t
+rmw_hazcat_init_options_set_wait_spin(rmw_init_options_t * init_options, uint64_t spin_ns)
+{
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(init_options, RMW_RET_INVALID_ARGUMENT);
+  if (NULL == init_options->implementation_identifier) {
+    RMW_SET_ERROR_MSG("expected initialized init_options");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  if (init_options->implementation_identifier != rmw_get_implementation_identifier()) {
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
+  }
+
+  if (NULL == init_options->impl) {
+    rcutils_allocator_t * allocator = &init_options->allocator;
+    init_options->impl = allocator->allocate(sizeof(init_options_impl_t), allocator->state);
+    if (NULL == init_options->impl) {
+      RMW_SET_ERROR_MSG("Unable to allocate memory for init options");
+      return RMW_RET_BAD_ALLOC;
+    }
+    memset(init_options->impl, 0, sizeof(init_options_impl_t));
+  }
+  ((init_options_impl_t *)init_options->impl)->wait_spin_ns = spin_ns;
+
+  return RMW_RET_OK;
+}
+
 rmw_ret_t
 rmw_init(const rmw_init_options_t * options, rmw_context_t * context)
 {
@@ -20,6 +20,7 @@
 #include "rmw/validate_node_name.h"
 
 #include "rmw_hazcat/hazcat_node.h"
+#include "rmw_hazcat/hazcat_ros_graph.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -102,6 +103,27 @@ rmw_create_node(
 
   node->context = context;
 
+  node_info_t * info = node->data;
+  if (RMW_RET_OK != hazcat_graph_add_node(node, &info->graph_slot)) {
+    rmw_destroy_guard_condition(info->guard_condition_);
+    rmw_free(node->namespace_);
+    rmw_free(node->name);
+    rmw_free(node->data);
+    rmw_free(node);
+    return NULL;
+  }
+
+  // The graph guard condition fires on changes made by any process
+  if (RMW_RET_OK != hazcat_graph_watch(info->guard_condition_)) {
+    hazcat_graph_remove_node(info->graph_slot);
+    rmw_destroy_guard_condition(info->guard_condition_);
+    rmw_free(node->namespace_);
+    rmw_free(node->name);
+    rmw_free(node->data);
+    rmw_free(node);
+    return NULL;
+  }
+
   return node;
 }
 
@@ -113,6 +135,14 @@ rmw_destroy_node(rmw_node_t * node)
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
 
+  node_info_t * info = node->data;
+  rmw_ret_t ret = hazcat_graph_remove_node(info->graph_slot);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+  hazcat_graph_unwatch(info->guard_condition_);
+  rmw_destroy_guard_condition(info->guard_condition_);
+
   rmw_free(node->namespace_);
   rmw_free(node->name);
   rmw_free(node->data);
@@ -157,8 +187,7 @@ rmw_get_node_names(
     return RMW_RET_INVALID_ARGUMENT;
   }
 
-  RMW_SET_ERROR_MSG("rmw_node_get_graph_guard_condition hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  return hazcat_graph_get_node_names(node_names, node_namespaces, NULL);
 }
 
 rmw_ret_t
@@ -185,8 +214,7 @@ rmw_get_node_names_with_enclaves(
     return RMW_RET_INVALID_ARGUMENT;
   }
 
-  RMW_SET_ERROR_MSG("rmw_node_get_graph_guard_condition hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  return hazcat_graph_get_node_names(node_names, node_namespaces, enclaves);
 }
 #ifdef __cplusplus
 }
@@ -28,6 +28,8 @@
 #include "rmw/validate_namespace.h"
 #include "rmw/validate_node_name.h"
 
+#include "rmw_hazcat/hazcat_ros_graph.h"
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -75,10 +77,10 @@ rmw_get_subscriber_names_and_types_by_node(
   if (RMW_RET_OK != ret) {
     return ret;
   }
-  (void) no_demangle; \
 
-  RMW_SET_ERROR_MSG("rmw_get_subscriber_names_and_types_by_node hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  return hazcat_graph_get_names_and_types(
+    node_name, node_namespace, GRAPH_SUBSCRIPTION, false, no_demangle, allocator,
+    topic_names_and_types);
 }
 
 rmw_ret_t
@@ -124,10 +126,10 @@ rmw_get_publisher_names_and_types_by_node(
   if (RMW_RET_OK != ret) {
     return ret;
   }
-  (void) no_demangle;
 
-  RMW_SET_ERROR_MSG("rmw_get_publisher_names_and_types_by_node hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  return hazcat_graph_get_names_and_types(
+    node_name, node_namespace, GRAPH_PUBLISHER, false, no_demangle, allocator,
+    topic_names_and_types);
 }
 
 rmw_ret_t
@@ -173,8 +175,10 @@ rmw_get_service_names_and_types_by_node(
     return ret;
   }
 
-  RMW_SET_ERROR_MSG("rmw_get_service_names_and_types_by_node hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  // A service subscribes to its request topic
+  return hazcat_graph_get_names_and_types(
+    node_name, node_namespace, GRAPH_SUBSCRIPTION, true, false, allocator,
+    service_names_and_types);
 }
 
 rmw_ret_t
@@ -197,8 +201,9 @@ rmw_get_service_names_and_types(
     return ret;
   }
 
-  RMW_SET_ERROR_MSG("rmw_get_service_names_and_types hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  return hazcat_graph_get_names_and_types(
+    NULL, NULL, GRAPH_PUBLISHER | GRAPH_SUBSCRIPTION, true, false, allocator,
+    service_names_and_types);
 }
 
 rmw_ret_t
@@ -244,8 +249,9 @@ rmw_get_client_names_and_types_by_node(
     return ret;
   }
 
-  RMW_SET_ERROR_MSG("rmw_get_client_names_and_types_by_node hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  // A client publishes to its service's request topic
+  return hazcat_graph_get_names_and_types(
+    node_name, node_namespace, GRAPH_PUBLISHER, true, false, allocator, service_names_and_types);
 }
 
 rmw_ret_t
@@ -267,10 +273,10 @@ rmw_get_topic_names_and_types(
   if (RMW_RET_OK != ret) {
     return ret;
   }
-  (void)no_demangle;
 
-  RMW_SET_ERROR_MSG("rmw_get_topic_names_and_types hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  return hazcat_graph_get_names_and_types(
+    NULL, NULL, GRAPH_PUBLISHER | GRAPH_SUBSCRIPTION, false, no_demangle, allocator,
+    topic_names_and_types);
 }
 #ifdef __cplusplus
 }
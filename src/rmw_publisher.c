@@ -21,28 +21,174 @@
 #include "rmw/get_topic_names_and_types.h"
 #include "rmw/names_and_types.h"
 #include "rmw/sanity_checks.h"
+#include "rmw/validate_full_topic_name.h"
 #include "rmw/validate_namespace.h"
 #include "rmw/validate_node_name.h"
 
+#include "rosidl_runtime_c/message_initialization.h"
+
 #include "hazcat_allocators/cpu_ringbuf_allocator.h"
 #include "hazcat/hazcat_message_queue.h"
 
+#include "rmw_hazcat/hazcat_gid.h"
+#include "rmw_hazcat/hazcat_message.h"
+#include "rmw_hazcat/hazcat_node.h"
+#include "rmw_hazcat/hazcat_ros_graph.h"
+#include "rmw_hazcat/hazcat_publisher.h"
+#include "rmw_hazcat/hazcat_serialize.h"
+#include "rmw_hazcat/hazcat_typesupport.h"
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
-rmw_gid_t
-generate_gid()
+// Allocate a block for a size byte message, and return where the message goes, behind its header
+static void *
+allocate_message(publisher_info_t * info, size_t size)
 {
-  rmw_gid_t gid;
-  gid.implementation_identifier = rmw_get_implementation_identifier();
-  memset(&gid.data[0], 0, RMW_GID_STORAGE_SIZE);
+  hma_allocator_t * alloc = info->data.alloc;
+  int offset = ALLOCATE(alloc, HAZCAT_MESSAGE_HEADER_SIZE + size);
+  if (offset < 0) {
+    return NULL;
+  }
+  return GET_PTR(alloc, offset, uint8_t) + HAZCAT_MESSAGE_HEADER_SIZE;
+}
+
+static void
+deallocate_message(publisher_info_t * info, const void * msg)
+{
+  hma_allocator_t * alloc = info->data.alloc;
+  int offset = PTR_TO_OFFSET(alloc, hazcat_message_header(msg));
+  DEALLOCATE(alloc, offset);
+}
+
+// Publishing counts toward the deadline, and asserts liveliness if it's manual
+static inline void
+note_publish(publisher_info_t * info)
+{
+  if (0 == info->deadline.period && 0 == info->liveliness.period) {
+    return;
+  }
+  int64_t now = hazcat_monotonic_now();
+  if (0 != info->deadline.period) {
+    hazcat_event_timer_restart(&info->deadline, now);
+  }
+  if (0 != info->liveliness.period) {
+    hazcat_event_timer_restart(&info->liveliness, now);
+    hazcat_graph_assert_liveliness(info->graph_slot, now);
+  }
+}
+
+// True if the topic has no subscribers, in which case the message is counted as skipped and the
+// caller drops it. Subscribers only ever see messages enqueued after they registered, so a
+// subscriber registering concurrently loses nothing: a publish that still reads 0 here is ordered
+// before the registration, and enqueueing the message wouldn't have reached that subscriber either
+static inline bool
+skip_publish(publisher_info_t * info)
+{
+  if (0 != __atomic_load_n(&info->data.mq->elem->sub_count, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+  __atomic_fetch_add(&info->skipped, 1, __ATOMIC_RELAXED);
+  return true;
+}
+
+// Stamp msg's header and enqueue its block. size is the message's, not counting the header.
+// sequence_number 0 stamps it with the publisher's next one
+static rmw_ret_t
+publish_message(publisher_info_t * info, void * msg, size_t size, uint64_t sequence_number)
+{
+  message_header_t * header = hazcat_message_header(msg);
+  header->source_timestamp = hazcat_now();
+  header->sequence_number = (0 != sequence_number) ? sequence_number :
+    __atomic_add_fetch(&info->sequence_number, 1, __ATOMIC_RELAXED);
+  memcpy(&header->publisher_gid, info->data.gid.data, sizeof(gid_layout_t));
+
+  return hazcat_publish(&info->data, header, HAZCAT_MESSAGE_HEADER_SIZE + size);
+}
+
+// Replace the publisher's allocator with one whose blocks hold at least needed bytes. Messages
+// already in the old one stay where they are until they're taken, since each queue entry names
+// the allocator its message is in
+static rmw_ret_t
+grow_blocks(publisher_info_t * info, size_t needed)
+{
+  rmw_ret_t ret = RMW_RET_OK;
+  pthread_rwlock_wrlock(&info->alloc_lock);
+  if (needed > info->block_size) {
+    size_t block_size = 2 * info->block_size;
+    while (block_size < needed) {
+      block_size *= 2;
+    }
+    hma_allocator_t * alloc = create_cpu_ringbuf_allocator(block_size, info->data.depth);
+    if (NULL == alloc) {
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
+        "Unable to create allocator with blocks of %zu bytes for publisher", block_size);
+      ret = RMW_RET_ERROR;
+    } else {
+      info->data.alloc = alloc;
+      info->block_size = block_size;
+    }
+  }
+  pthread_rwlock_unlock(&info->alloc_lock);
+  return ret;
+}
+
+// Copy ros_message into a block of shared memory and enqueue it. The caller keeps ros_message, and
+// has already called note_publish and skip_publish
+static rmw_ret_t
+enqueue_copy(publisher_info_t * info, const void * ros_message, uint64_t sequence_number)
+{
+  size_t size = info->data.msg_size - HAZCAT_MESSAGE_HEADER_SIZE;
+  if (info->is_flat) {
+    void * zc_msg = allocate_message(info, size);
+    if (NULL == zc_msg) {
+      RMW_SET_ERROR_MSG("unable to allocate memory for message.");
+      return RMW_RET_ERROR;
+    }
+    memcpy(zc_msg, ros_message, size);
+    return publish_message(info, zc_msg, size, sequence_number);
+  }
 
-  static size_t dummy_guid = 0;
-  dummy_guid++;
-  memcpy(&gid.data[0], &dummy_guid, sizeof(size_t));
+  // Strings and sequences get packed in behind the message, so it only takes up as much of the
+  // block as it actually needs. The size is stored with the message, so subscribers, and any
+  // copies to other domains, only touch that many bytes. Messages too large for the blocks of an
+  // allocator rmw_hazcat made move the publisher to larger ones. The allocator can only change
+  // while no message is between being allocated and enqueued
+  size = hazcat_message_size(info->members, ros_message);
+  size_t needed = HAZCAT_MESSAGE_HEADER_SIZE + size;
+  pthread_rwlock_rdlock(&info->alloc_lock);
+  while (0 != info->block_size && needed > info->block_size) {
+    pthread_rwlock_unlock(&info->alloc_lock);
+    rmw_ret_t ret = grow_blocks(info, needed);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+    pthread_rwlock_rdlock(&info->alloc_lock);
+  }
 
-  return gid;
+  rmw_ret_t ret;
+  void * zc_msg = allocate_message(info, size);
+  if (NULL == zc_msg) {
+    RMW_SET_ERROR_MSG("unable to allocate memory for message.");
+    ret = RMW_RET_ERROR;
+  } else {
+    hazcat_message_pack(info->members, ros_message, zc_msg);
+    ret = publish_message(info, zc_msg, size, sequence_number);
+  }
+  pthread_rwlock_unlock(&info->alloc_lock);
+
+  return ret;
+}
+
+static rmw_ret_t
+publish_copy(publisher_info_t * info, const void * ros_message, uint64_t sequence_number)
+{
+  note_publish(info);
+  if (skip_publish(info)) {
+    return RMW_RET_OK;
+  }
+  return enqueue_copy(info, ros_message, sequence_number);
 }
 
 rmw_ret_t
@@ -55,17 +201,28 @@ rmw_init_publisher_allocation(
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(message_bounds, RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
 
-  RMW_SET_ERROR_MSG("rmw_init_publisher_allocation hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  allocation_info_t * data;
+  rmw_ret_t ret = hazcat_allocation_init(type_support, &data);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+  allocation->data = data;
+  allocation->implementation_identifier = rmw_get_implementation_identifier();
+
+  return RMW_RET_OK;
 }
 
 rmw_ret_t
 rmw_fini_publisher_allocation(rmw_publisher_allocation_t * allocation)
 {
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
+  HAZCAT_CHECK_ALLOCATION(allocation);
 
-  RMW_SET_ERROR_MSG("rmw_fini_publisher_allocation hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  hazcat_allocation_fini(allocation->data);
+  allocation->implementation_identifier = NULL;
+  allocation->data = NULL;
+
+  return RMW_RET_OK;
 }
 
 rmw_publisher_t *
@@ -116,33 +273,62 @@ rmw_create_publisher(
     RMW_SET_ERROR_MSG("Unable to get serialized message size");
     return NULL;
   }
+  const type_info_t * type = hazcat_type_info(type_supports);
+  if (NULL == type) {
+    return NULL;
+  }
+  // Only C messages can have their strings and sequences packed into shared memory. C++ ones would
+  // be copied with pointers into the heap of the process that published them
+  if (type->is_cpp && !type->is_pod) {
+    RMW_SET_ERROR_MSG("C++ messages with strings or sequences aren't supported by rmw_hazcat");
+    return NULL;
+  }
+  const rosidl_typesupport_introspection_c__MessageMembers * members =
+    hazcat_message_members(type_supports);
+  bool is_flat = type->is_pod;
 
   rmw_publisher_t * pub = rmw_publisher_allocate();
   if (NULL == pub) {
     RMW_SET_ERROR_MSG("Unable to allocate memory for publisher");
     return NULL;
   }
-  pub_sub_data_t * data = rmw_allocate(sizeof(pub_sub_data_t));
-  if (NULL == data) {
+  size_t depth = (qos_policies->depth > 1) ? qos_policies->depth : 1;
+  publisher_info_t * info = rmw_allocate(sizeof(publisher_info_t));
+  if (NULL == info) {
     RMW_SET_ERROR_MSG("Unable to allocate memory for publisher info");
     return NULL;
   }
+  info->type = type;
+  info->members = members;
+  info->is_flat = is_flat;
+  info->sequence_number = 0;
+  info->skipped = 0;
+  info->qos = *qos_policies;
+  hazcat_event_timer_init(
+    &info->deadline, RMW_EVENT_OFFERED_DEADLINE_MISSED, pub,
+    hazcat_duration_ns(qos_policies->deadline));
+  hazcat_event_timer_init(
+    &info->liveliness, RMW_EVENT_LIVELINESS_LOST, pub,
+    (RMW_QOS_POLICY_LIVELINESS_MANUAL_BY_TOPIC == qos_policies->liveliness) ?
+    hazcat_duration_ns(qos_policies->liveliness_lease_duration) : 0);
+  pub_sub_data_t * data = &info->data;
 
   // Populate data->alloc with allocator specified (all other fields are set during registration)
   data->alloc = (hma_allocator_t *)publisher_options->rmw_specific_publisher_payload;
+  info->block_size = 0;
+  pthread_rwlock_init(&info->alloc_lock, NULL);
   if (NULL == data->alloc) {
-    // TODO(nightduck): Replace hard coded values when serialization works
-    //                  Remove all together when TLSF allocator is done
-    data->alloc =
-      create_cpu_ringbuf_allocator(msg_size, qos_policies->depth);
+    // TODO(nightduck): Remove all together when TLSF allocator is done
+    info->block_size = hazcat_message_block_size(members, is_flat, msg_size);
+    data->alloc = create_cpu_ringbuf_allocator(info->block_size, depth);
     if (NULL == data->alloc) {
       RMW_SET_ERROR_MSG("Unable to create allocator for publisher");
       return NULL;
     }
   }
-  data->depth = (qos_policies->depth > 1) ? qos_policies->depth : 1;
-  data->msg_size = msg_size;
-  data->gid = generate_gid();
+  data->depth = depth;
+  data->msg_size = HAZCAT_MESSAGE_HEADER_SIZE + msg_size;
+  data->gid = hazcat_generate_gid();
   data->context = node->context;
   sem_init(&data->lock, 0, 1);
 
@@ -150,7 +336,7 @@ rmw_create_publisher(
   pub->data = data;
   pub->topic_name = rmw_allocate(strlen(topic_name) + 1);
   pub->options = *publisher_options;
-  pub->can_loan_messages = true;
+  pub->can_loan_messages = is_flat;
 
   if (NULL == pub->topic_name) {
     RMW_SET_ERROR_MSG("Unable to allocate string for publisher's topic name");
@@ -162,6 +348,14 @@ rmw_create_publisher(
     return NULL;
   }
 
+  ret = hazcat_graph_add_endpoint(
+    ((node_info_t *)node->data)->graph_slot, GRAPH_PUBLISHER, topic_name, type->type_name,
+    &data->gid, qos_policies, &info->graph_slot);
+  if (RMW_RET_OK != ret) {
+    hazcat_unregister_publisher(pub->data);
+    return NULL;
+  }
+
   return pub;
 }
 
@@ -183,6 +377,15 @@ rmw_destroy_publisher(rmw_node_t * node, rmw_publisher_t * publisher)
     return ret;
   }
 
+  publisher_info_t * info = (publisher_info_t *)publisher->data;
+  ret = hazcat_graph_remove_endpoint(info->graph_slot);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+  hazcat_event_timer_fini(&info->deadline);
+  hazcat_event_timer_fini(&info->liveliness);
+  pthread_rwlock_destroy(&info->alloc_lock);
+
   // Free all allocated memory associated with publisher
   rmw_free(publisher->topic_name);
   rmw_free(publisher->data);
@@ -213,8 +416,15 @@ rmw_publisher_assert_liveliness(const rmw_publisher_t * publisher)
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
 
-  RMW_SET_ERROR_MSG("rmw_publisher_assert_liveliness hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  // Automatic liveliness needs no asserting
+  publisher_info_t * info = (publisher_info_t *)publisher->data;
+  if (0 != info->liveliness.period) {
+    int64_t now = hazcat_monotonic_now();
+    hazcat_event_timer_restart(&info->liveliness, now);
+    hazcat_graph_assert_liveliness(info->graph_slot, now);
+  }
+
+  return RMW_RET_OK;
 }
 
 rmw_ret_t
@@ -239,17 +449,17 @@ rmw_publisher_get_actual_qos(const rmw_publisher_t * publisher, rmw_qos_profile_
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
 
+  const publisher_info_t * info = (const publisher_info_t *)publisher->data;
   qos->history = RMW_QOS_POLICY_HISTORY_KEEP_LAST;
-  qos->depth = ((pub_sub_data_t *)publisher->data)->mq->elem->len;
+  qos->depth = info->data.mq->elem->len;
   qos->reliability = RMW_QOS_POLICY_RELIABILITY_RELIABLE;
   qos->durability = RMW_QOS_POLICY_DURABILITY_VOLATILE;
-  qos->deadline.nsec = 0;
-  qos->deadline.sec = 0;
+  qos->deadline = info->qos.deadline;
   qos->lifespan.nsec = 0;
   qos->lifespan.sec = 0;
-  qos->liveliness = RMW_QOS_POLICY_LIVELINESS_AUTOMATIC;
-  qos->liveliness_lease_duration.nsec = 0;
-  qos->liveliness_lease_duration.sec = 0;
+  qos->liveliness = (RMW_QOS_POLICY_LIVELINESS_MANUAL_BY_TOPIC == info->qos.liveliness) ?
+    RMW_QOS_POLICY_LIVELINESS_MANUAL_BY_TOPIC : RMW_QOS_POLICY_LIVELINESS_AUTOMATIC;
+  qos->liveliness_lease_duration = info->qos.liveliness_lease_duration;
   qos->avoid_ros_namespace_conventions = false;
 
   return RMW_RET_OK;
@@ -266,21 +476,38 @@ rmw_publish(
   if (publisher->implementation_identifier != rmw_get_implementation_identifier()) {
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
+  HAZCAT_CHECK_ALLOCATION(allocation);
 
-  // TODO(nightduck): Implement per-message size, in case messages are smaller than upper bound
-  size_t size = ((pub_sub_data_t *)publisher->data)->msg_size;
+  return publish_copy(publisher->data, ros_message, 0);
+}
 
-  hma_allocator_t * alloc = ((pub_sub_data_t *)publisher->data)->alloc;
-  int offset = ALLOCATE(alloc, size);
-  if (offset < 0) {
-    RMW_SET_ERROR_MSG("unable to allocate memory for message.");
-    printf("Size requested: %d\n", size);
-    return RMW_RET_ERROR;
+rmw_ret_t
+hazcat_publisher_publish(
+  const rmw_publisher_t * publisher,
+  const void * ros_message,
+  uint64_t sequence_number)
+{
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(publisher, RMW_RET_INVALID_ARGUMENT);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(ros_message, RMW_RET_INVALID_ARGUMENT);
+  if (publisher->implementation_identifier != rmw_get_implementation_identifier()) {
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
-  void * zc_msg = GET_PTR(alloc, offset, void);
-  memcpy(zc_msg, ros_message, size);
 
-  return hazcat_publish(publisher->data, zc_msg, size);
+  return publish_copy(publisher->data, ros_message, sequence_number);
+}
+
+rmw_ret_t
+hazcat_publisher_get_skipped_count(const rmw_publisher_t * publisher, uint64_t * count)
+{
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(publisher, RMW_RET_INVALID_ARGUMENT);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(count, RMW_RET_INVALID_ARGUMENT);
+  if (publisher->implementation_identifier != rmw_get_implementation_identifier()) {
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
+  }
+
+  *count = __atomic_load_n(&((publisher_info_t *)publisher->data)->skipped, __ATOMIC_RELAXED);
+
+  return RMW_RET_OK;
 }
 
 rmw_ret_t
@@ -294,9 +521,57 @@ rmw_publish_serialized_message(
   if (publisher->implementation_identifier != rmw_get_implementation_identifier()) {
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
+  HAZCAT_CHECK_ALLOCATION(allocation);
 
-  RMW_SET_ERROR_MSG("rmw_publish_serialized_message hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  publisher_info_t * info = (publisher_info_t *)publisher->data;
+  note_publish(info);
+  if (skip_publish(info)) {
+    return RMW_RET_OK;
+  }
+
+  // Flat messages, C++ ones included, are decoded straight into the block that gets enqueued
+  if (info->is_flat) {
+    size_t size = info->data.msg_size - HAZCAT_MESSAGE_HEADER_SIZE;
+    void * zc_msg = allocate_message(info, size);
+    if (NULL == zc_msg) {
+      RMW_SET_ERROR_MSG("unable to allocate memory for message");
+      return RMW_RET_ERROR;
+    }
+    rmw_ret_t ret = hazcat_deserialize(info->type, serialized_message, zc_msg);
+    if (RMW_RET_OK != ret) {
+      deallocate_message(info, zc_msg);
+      return ret;
+    }
+    return publish_message(info, zc_msg, size, 0);
+  }
+
+  // Packed messages can't be decoded straight into the block, since their packed size isn't known
+  // until the strings and sequences have been read. They're decoded into the allocation's scratch
+  // message if there is one, or a temporary one otherwise, and packed from there
+  void * ros_message = hazcat_allocation_scratch(
+    (NULL == allocation) ? NULL : allocation->data, info->members);
+  if (NULL != ros_message) {
+    rmw_ret_t ret = hazcat_deserialize(info->type, serialized_message, ros_message);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+    return enqueue_copy(info, ros_message, 0);
+  }
+
+  ros_message = rmw_allocate(info->members->size_of_);
+  if (NULL == ros_message) {
+    RMW_SET_ERROR_MSG("unable to allocate memory for message");
+    return RMW_RET_BAD_ALLOC;
+  }
+  info->members->init_function(ros_message, ROSIDL_RUNTIME_C_MSG_INIT_ALL);
+  rmw_ret_t ret = hazcat_deserialize(info->type, serialized_message, ros_message);
+  if (RMW_RET_OK == ret) {
+    ret = enqueue_copy(info, ros_message, 0);
+  }
+  info->members->fini_function(ros_message);
+  rmw_free(ros_message);
+
+  return ret;
 }
 
 rmw_ret_t
@@ -315,6 +590,10 @@ rmw_borrow_loaned_message(
     RMW_SET_ERROR_MSG("Non-null message given to rmw_borrow_loaned_message");
     return RMW_RET_INVALID_ARGUMENT;
   }
+  if (!((publisher_info_t *)publisher->data)->is_flat) {
+    RMW_SET_ERROR_MSG("Messages with strings or sequences can't be loaned");
+    return RMW_RET_UNSUPPORTED;
+  }
 
   rmw_ret_t ret;
   size_t size;
@@ -324,13 +603,13 @@ rmw_borrow_loaned_message(
     return ret;
   }
 
-  hma_allocator_t * alloc = ((pub_sub_data_t *)publisher->data)->alloc;
-  int offset = ALLOCATE(alloc, size);
-  if (offset < 0) {
+  publisher_info_t * info = (publisher_info_t *)publisher->data;
+  void * msg = allocate_message(info, size);
+  if (NULL == msg) {
     RMW_SET_ERROR_MSG("unable to allocate memory for message");
     return RMW_RET_ERROR;
   }
-  *ros_message = GET_PTR(alloc, offset, void);
+  *ros_message = msg;
 
   return RMW_RET_OK;
 }
@@ -340,11 +619,11 @@ rmw_return_loaned_message_from_publisher(const rmw_publisher_t * publisher, void
 {
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(publisher, RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(loaned_message, RMW_RET_INVALID_ARGUMENT);
+  if (publisher->implementation_identifier != rmw_get_implementation_identifier()) {
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
+  }
 
-  hma_allocator_t * alloc = ((pub_sub_data_t *)publisher->data)->alloc;
-
-  int offset = PTR_TO_OFFSET(alloc, loaned_message);
-  DEALLOCATE(alloc, offset);
+  deallocate_message(publisher->data, loaned_message);
 
   return RMW_RET_OK;
 }
@@ -357,13 +636,21 @@ rmw_publish_loaned_message(
 {
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(publisher, RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(ros_message, RMW_RET_INVALID_ARGUMENT);
+  if (publisher->implementation_identifier != rmw_get_implementation_identifier()) {
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
+  }
 
-  hma_allocator_t * alloc = ((pub_sub_data_t *)publisher->data)->alloc;
+  publisher_info_t * info = (publisher_info_t *)publisher->data;
+  note_publish(info);
+  if (skip_publish(info)) {
+    deallocate_message(info, ros_message);
+    return RMW_RET_OK;
+  }
 
-  // TODO(nightduck): Implement per-message size, in case messages are smaller than upper bound
-  size_t size = ((pub_sub_data_t *)publisher->data)->msg_size;
+  // Loaned messages are always flat, so they're exactly as large as the type
+  size_t size = info->data.msg_size - HAZCAT_MESSAGE_HEADER_SIZE;
 
-  return hazcat_publish(publisher->data, ros_message, size);
+  return publish_message(info, ros_message, size, 0);
 }
 
 rmw_ret_t rmw_get_publishers_info_by_topic(
@@ -378,25 +665,27 @@ rmw_ret_t rmw_get_publishers_info_by_topic(
   if (node->implementation_identifier != rmw_get_implementation_identifier()) {
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
-  int validation_result = RMW_NODE_NAME_VALID;
-  rmw_ret_t ret = rmw_validate_node_name(topic_name, &validation_result, NULL);
-  if (RMW_RET_OK != ret) {
-    return ret;
-  }
-  if (RMW_NODE_NAME_VALID != validation_result) {
-    const char * reason = rmw_node_name_validation_result_string(validation_result);
-    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("node_name argument is invalid: %s", reason);
-    return RMW_RET_INVALID_ARGUMENT;
+  // Topics are kept under the names they were created with, so no_mangle only means the name
+  // needn't follow ROS conventions
+  if (!no_mangle) {
+    int validation_result = RMW_TOPIC_VALID;
+    rmw_ret_t ret = rmw_validate_full_topic_name(topic_name, &validation_result, NULL);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+    if (RMW_TOPIC_VALID != validation_result) {
+      const char * reason = rmw_full_topic_name_validation_result_string(validation_result);
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("topic_name argument is invalid: %s", reason);
+      return RMW_RET_INVALID_ARGUMENT;
+    }
   }
   RCUTILS_CHECK_ALLOCATOR_WITH_MSG(
     allocator, "allocator argument is invalid", return RMW_RET_INVALID_ARGUMENT);
   if (RMW_RET_OK != rmw_topic_endpoint_info_array_check_zero(publishers_info)) {
     return RMW_RET_INVALID_ARGUMENT;
   }
-  (void)no_mangle;
 
-  RMW_SET_ERROR_MSG("rmw_get_publishers_info_by_topic hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  return hazcat_graph_get_endpoint_info(topic_name, GRAPH_PUBLISHER, allocator, publishers_info);
 }
 
 rmw_publisher_options_t
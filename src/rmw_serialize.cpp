@@ -0,0 +1,997 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <ucdr/microcdr.h>
+
+#include "rmw/allocators.h"
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rosidl_runtime_c/string.h"
+#include "rosidl_runtime_c/string_functions.h"
+#include "rosidl_runtime_c/u16string_functions.h"
+
+#include "rosidl_typesupport_c/message_type_support_dispatch.h"
+
+#include "rosidl_typesupport_introspection_c/field_types.h"
+#include "rosidl_typesupport_introspection_c/identifier.h"
+#include "rosidl_typesupport_introspection_c/message_introspection.h"
+
+#include "rosidl_typesupport_introspection_cpp/field_types.hpp"
+#include "rosidl_typesupport_introspection_cpp/message_introspection.hpp"
+
+#include "rmw_hazcat/hazcat_message.h"
+#include "rmw_hazcat/hazcat_serialize.h"
+#include "rmw_hazcat/hazcat_typesupport.h"
+
+// Size of the CDR encapsulation header that starts every serialized message
+#define ENCAPSULATION_SIZE 4
+
+// Representation identifiers, the second byte of the encapsulation header
+#define CDR_BE 0x00
+#define CDR_LE 0x01
+
+// CDR gives a long double 16 bytes, aligned to 8, whatever its size in memory
+#define LONG_DOUBLE_SIZE 16
+
+namespace
+{
+
+using CMembers = rosidl_typesupport_introspection_c__MessageMembers;
+using CppMembers = rosidl_typesupport_introspection_cpp::MessageMembers;
+
+// Long doubles are written as LONG_DOUBLE_SIZE raw bytes. Their format differs between machines
+// anyway, but like any other primitive, their bytes are swapped when the buffer's byte order
+// isn't the machine's
+bool
+serialize_long_doubles(ucdrBuffer * writer, const long double * values, size_t count)
+{
+  for (size_t i = 0; i < count; i++) {
+    uint8_t bytes[LONG_DOUBLE_SIZE] = {0};
+    memcpy(bytes, values + i, sizeof(long double));
+    if (UCDR_MACHINE_ENDIANNESS != writer->endianness) {
+      std::reverse(bytes, bytes + LONG_DOUBLE_SIZE);
+    }
+    ucdr_align_to(writer, sizeof(uint64_t));
+    if (!ucdr_serialize_array_uint8_t(writer, bytes, LONG_DOUBLE_SIZE)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool
+deserialize_long_doubles(ucdrBuffer * reader, long double * values, size_t count)
+{
+  for (size_t i = 0; i < count; i++) {
+    uint8_t bytes[LONG_DOUBLE_SIZE];
+    ucdr_align_to(reader, sizeof(uint64_t));
+    if (!ucdr_deserialize_array_uint8_t(reader, bytes, LONG_DOUBLE_SIZE)) {
+      return false;
+    }
+    if (UCDR_MACHINE_ENDIANNESS != reader->endianness) {
+      std::reverse(bytes, bytes + LONG_DOUBLE_SIZE);
+    }
+    memcpy(values + i, bytes, sizeof(long double));
+  }
+  return true;
+}
+
+// Encode count contiguous primitives of type type_id. Primitives look the same in both flavours
+bool
+serialize_primitives(ucdrBuffer * writer, uint8_t type_id, const void * data, size_t count)
+{
+  switch (type_id) {
+    case rosidl_typesupport_introspection_c__ROS_TYPE_FLOAT:
+      return ucdr_serialize_array_float(writer, static_cast<const float *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_DOUBLE:
+      return ucdr_serialize_array_double(writer, static_cast<const double *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_LONG_DOUBLE:
+      return serialize_long_doubles(writer, static_cast<const long double *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_CHAR:
+      return ucdr_serialize_array_char(writer, static_cast<const char *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_BOOLEAN:
+      return ucdr_serialize_array_bool(writer, static_cast<const bool *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_OCTET:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT8:
+      return ucdr_serialize_array_uint8_t(writer, static_cast<const uint8_t *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT8:
+      return ucdr_serialize_array_int8_t(writer, static_cast<const int8_t *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_WCHAR:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT16:
+      return ucdr_serialize_array_uint16_t(writer, static_cast<const uint16_t *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT16:
+      return ucdr_serialize_array_int16_t(writer, static_cast<const int16_t *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT32:
+      return ucdr_serialize_array_uint32_t(writer, static_cast<const uint32_t *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT32:
+      return ucdr_serialize_array_int32_t(writer, static_cast<const int32_t *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT64:
+      return ucdr_serialize_array_uint64_t(writer, static_cast<const uint64_t *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT64:
+      return ucdr_serialize_array_int64_t(writer, static_cast<const int64_t *>(data), count);
+    default:
+      RMW_SET_ERROR_MSG("Serializing unknown type");
+      return false;
+  }
+}
+
+bool
+deserialize_primitives(ucdrBuffer * reader, uint8_t type_id, void * data, size_t count)
+{
+  switch (type_id) {
+    case rosidl_typesupport_introspection_c__ROS_TYPE_FLOAT:
+      return ucdr_deserialize_array_float(reader, static_cast<float *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_DOUBLE:
+      return ucdr_deserialize_array_double(reader, static_cast<double *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_LONG_DOUBLE:
+      return deserialize_long_doubles(reader, static_cast<long double *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_CHAR:
+      return ucdr_deserialize_array_char(reader, static_cast<char *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_BOOLEAN:
+      return ucdr_deserialize_array_bool(reader, static_cast<bool *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_OCTET:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT8:
+      return ucdr_deserialize_array_uint8_t(reader, static_cast<uint8_t *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT8:
+      return ucdr_deserialize_array_int8_t(reader, static_cast<int8_t *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_WCHAR:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT16:
+      return ucdr_deserialize_array_uint16_t(reader, static_cast<uint16_t *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT16:
+      return ucdr_deserialize_array_int16_t(reader, static_cast<int16_t *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT32:
+      return ucdr_deserialize_array_uint32_t(reader, static_cast<uint32_t *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT32:
+      return ucdr_deserialize_array_int32_t(reader, static_cast<int32_t *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT64:
+      return ucdr_deserialize_array_uint64_t(reader, static_cast<uint64_t *>(data), count);
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT64:
+      return ucdr_deserialize_array_int64_t(reader, static_cast<int64_t *>(data), count);
+    default:
+      RMW_SET_ERROR_MSG("Deserializing unknown type");
+      return false;
+  }
+}
+
+// Strings are encoded as their length, counting the terminator, followed by their characters and
+// the terminator. Returns the length of the string that follows, or -1 if it's malformed
+int64_t
+deserialize_string_length(ucdrBuffer * reader, size_t bound)
+{
+  uint32_t len;
+  if (!ucdr_deserialize_uint32_t(reader, &len)) {
+    return -1;
+  }
+  if (0 == len || len > ucdr_buffer_remaining(reader) || (0 != bound && len - 1 > bound)) {
+    RMW_SET_ERROR_MSG("Serialized message has a malformed string");
+    return -1;
+  }
+  return len - 1;
+}
+
+// Wide strings are encoded as their length in code units, without a terminator, followed by
+// their UTF-16 code units
+int64_t
+deserialize_wstring_length(ucdrBuffer * reader, size_t bound)
+{
+  uint32_t len;
+  if (!ucdr_deserialize_uint32_t(reader, &len)) {
+    return -1;
+  }
+  if (len > ucdr_buffer_remaining(reader) / sizeof(uint16_t) || (0 != bound && len > bound)) {
+    RMW_SET_ERROR_MSG("Serialized message has a malformed wstring");
+    return -1;
+  }
+  return len;
+}
+
+// Everything that differs between messages generated for C and for C++. The rest of the
+// serializer is written once against this interface, and instantiated for each
+template<typename MembersT>
+struct Flavour;
+
+template<>
+struct Flavour<CMembers>
+{
+  typedef rosidl_typesupport_introspection_c__MessageMember Member;
+
+  static size_t
+  element_size(const Member * member)
+  {
+    return hazcat_member_element_size(member);
+  }
+
+  static size_t
+  sequence_size(const Member *, const void * field)
+  {
+    return static_cast<const sequence_t *>(field)->size;
+  }
+
+  static const void *
+  sequence_data(const Member *, const void * field)
+  {
+    return static_cast<const sequence_t *>(field)->data;
+  }
+
+  static void *
+  sequence_data(const Member *, void * field)
+  {
+    return static_cast<sequence_t *>(field)->data;
+  }
+
+  static bool
+  resize_sequence(const Member * member, void * field, size_t size)
+  {
+    return NULL != member->resize_function && member->resize_function(field, size);
+  }
+
+  // Only C++ has sequences that aren't arrays underneath
+  static bool
+  is_bit_vector(const Member *)
+  {
+    return false;
+  }
+
+  static bool
+  serialize_bits(ucdrBuffer *, const void *)
+  {
+    return false;
+  }
+
+  static bool
+  deserialize_bits(ucdrBuffer *, void *, size_t)
+  {
+    return false;
+  }
+
+  static bool
+  serialize_string(ucdrBuffer * writer, const void * field)
+  {
+    const rosidl_runtime_c__String * str = static_cast<const rosidl_runtime_c__String *>(field);
+    if (NULL == str->data) {
+      return ucdr_serialize_sequence_char(writer, "", 1);
+    }
+    return ucdr_serialize_sequence_char(writer, str->data, (uint32_t)(str->size + 1));
+  }
+
+  static bool
+  deserialize_string(ucdrBuffer * reader, void * field, size_t bound)
+  {
+    int64_t len = deserialize_string_length(reader, bound);
+    if (len < 0) {
+      return false;
+    }
+    if (!rosidl_runtime_c__String__assignn(
+        static_cast<rosidl_runtime_c__String *>(field),
+        reinterpret_cast<const char *>(reader->iterator), len))
+    {
+      RMW_SET_ERROR_MSG("Unable to assign string");
+      return false;
+    }
+    ucdr_advance_buffer(reader, len + 1);
+    return true;
+  }
+
+  static bool
+  serialize_wstring(ucdrBuffer * writer, const void * field)
+  {
+    const rosidl_runtime_c__U16String * str =
+      static_cast<const rosidl_runtime_c__U16String *>(field);
+    return ucdr_serialize_sequence_uint16_t(writer, str->data, (uint32_t)str->size);
+  }
+
+  static bool
+  deserialize_wstring(ucdrBuffer * reader, void * field, size_t bound)
+  {
+    int64_t len = deserialize_wstring_length(reader, bound);
+    if (len < 0) {
+      return false;
+    }
+    rosidl_runtime_c__U16String * str = static_cast<rosidl_runtime_c__U16String *>(field);
+    if (!rosidl_runtime_c__U16String__resize(str, len)) {
+      RMW_SET_ERROR_MSG("Unable to resize wstring");
+      return false;
+    }
+    return ucdr_deserialize_array_uint16_t(reader, str->data, len);
+  }
+};
+
+template<>
+struct Flavour<CppMembers>
+{
+  typedef rosidl_typesupport_introspection_cpp::MessageMember Member;
+
+  static size_t
+  element_size(const Member * member)
+  {
+    switch (member->type_id_) {
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_STRING:
+        return sizeof(std::string);
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_WSTRING:
+        return sizeof(std::u16string);
+      case rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE:
+        return static_cast<const CppMembers *>(member->members_->data)->size_of_;
+      default:
+        // Primitives are the same size in both flavours, and the C introspection member only
+        // needs its type_id_ to say so
+        rosidl_typesupport_introspection_c__MessageMember c_member;
+        memset(&c_member, 0, sizeof(c_member));
+        c_member.type_id_ = member->type_id_;
+        return hazcat_member_element_size(&c_member);
+    }
+  }
+
+  static size_t
+  sequence_size(const Member * member, const void * field)
+  {
+    return member->size_function(field);
+  }
+
+  static const void *
+  sequence_data(const Member * member, const void * field)
+  {
+    return (0 == member->size_function(field)) ? nullptr : member->get_const_function(field, 0);
+  }
+
+  static void *
+  sequence_data(const Member * member, void * field)
+  {
+    return (0 == member->size_function(field)) ? nullptr : member->get_function(field, 0);
+  }
+
+  static bool
+  resize_sequence(const Member * member, void * field, size_t size)
+  {
+    if (nullptr == member->resize_function) {
+      return false;
+    }
+    member->resize_function(field, size);
+    return true;
+  }
+
+  // std::vector<bool> packs its elements into bits, so it can't be handed out as an array
+  static bool
+  is_bit_vector(const Member * member)
+  {
+    return rosidl_typesupport_introspection_cpp::ROS_TYPE_BOOLEAN == member->type_id_;
+  }
+
+  static bool
+  serialize_bits(ucdrBuffer * writer, const void * field)
+  {
+    const std::vector<bool> & bits = *static_cast<const std::vector<bool> *>(field);
+    for (bool bit : bits) {
+      if (!ucdr_serialize_bool(writer, bit)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static bool
+  deserialize_bits(ucdrBuffer * reader, void * field, size_t count)
+  {
+    std::vector<bool> & bits = *static_cast<std::vector<bool> *>(field);
+    for (size_t i = 0; i < count; i++) {
+      bool bit;
+      if (!ucdr_deserialize_bool(reader, &bit)) {
+        return false;
+      }
+      bits[i] = bit;
+    }
+    return true;
+  }
+
+  static bool
+  serialize_string(ucdrBuffer * writer, const void * field)
+  {
+    const std::string & str = *static_cast<const std::string *>(field);
+    return ucdr_serialize_sequence_char(writer, str.c_str(), (uint32_t)(str.size() + 1));
+  }
+
+  static bool
+  deserialize_string(ucdrBuffer * reader, void * field, size_t bound)
+  {
+    int64_t len = deserialize_string_length(reader, bound);
+    if (len < 0) {
+      return false;
+    }
+    static_cast<std::string *>(field)->assign(
+      reinterpret_cast<const char *>(reader->iterator), len);
+    ucdr_advance_buffer(reader, len + 1);
+    return true;
+  }
+
+  static bool
+  serialize_wstring(ucdrBuffer * writer, const void * field)
+  {
+    const std::u16string & str = *static_cast<const std::u16string *>(field);
+    return ucdr_serialize_sequence_uint16_t(
+      writer, reinterpret_cast<const uint16_t *>(str.data()), (uint32_t)str.size());
+  }
+
+  static bool
+  deserialize_wstring(ucdrBuffer * reader, void * field, size_t bound)
+  {
+    int64_t len = deserialize_wstring_length(reader, bound);
+    if (len < 0) {
+      return false;
+    }
+    std::u16string & str = *static_cast<std::u16string *>(field);
+    str.resize(len);
+    return 0 == len ||
+           ucdr_deserialize_array_uint16_t(reader, reinterpret_cast<uint16_t *>(&str[0]), len);
+  }
+};
+
+// A serialization plan is a message type flattened into a list of ops, built the first time the
+// type is serialized and cached for the life of the process. Nested messages are inlined, and
+// runs of primitive fields laid out in memory exactly as CDR would lay them out are preceded by
+// an OP_RUN that copies the whole run at once. Whether a run's layouts match depends on where in
+// the stream it falls, so that's checked as the run is reached, and its ops are executed one by
+// one if they don't.
+enum plan_op_kind_t
+{
+  OP_RUN,                         // Copy the next skip ops as count bytes, if alignment allows
+  OP_PRIMITIVES,                  // count primitives of type type_id
+  OP_STRINGS,                     // count strings
+  OP_WSTRINGS,                    // count wstrings
+  OP_MESSAGES,                    // count messages, each following sub
+  OP_SEQUENCE                     // A sequence of elem_kind elements
+};
+
+struct serialization_plan_t;
+
+struct plan_op_t
+{
+  plan_op_kind_t kind;
+  plan_op_kind_t elem_kind;       // For OP_SEQUENCE, the op its elements would have on their own
+  uint8_t type_id;                // Primitive type, for OP_PRIMITIVES and sequences of them
+  size_t offset;                  // Of the field, from the start of the (sub)message
+  size_t count;                   // Number of elements, or of bytes for OP_RUN
+  size_t skip;                    // Number of ops OP_RUN stands in for
+  size_t bound;                   // Upper bound of strings and sequences, 0 if unbounded
+  size_t stride;                  // Size of one element in memory
+  const void * member;            // Introspection member, for OP_SEQUENCE
+  const serialization_plan_t * sub;   // For messages, and sequences of them
+};
+
+struct serialization_plan_t
+{
+  const void * members;           // Introspection members of the type, in either flavour
+  serialization_plan_t * next;    // Next plan in the same cache bucket
+  size_t count;                   // Length of ops
+  plan_op_t * ops;                // Follows the plan in the same allocation
+};
+
+// Plans are kept in a hash table of lock-free lists, keyed by the address of the type's members.
+// Plans are only ever added, so readers never wait and never see one freed
+constexpr size_t kPlanCacheBuckets = 256;
+
+std::atomic<serialization_plan_t *> plan_cache[kPlanCacheBuckets];
+
+template<typename MembersT>
+const serialization_plan_t *
+get_plan(const MembersT * members);
+
+template<typename MembersT>
+bool
+describe_element(const typename Flavour<MembersT>::Member * member, plan_op_t * op)
+{
+  op->type_id = member->type_id_;
+  op->stride = Flavour<MembersT>::element_size(member);
+  switch (member->type_id_) {
+    case rosidl_typesupport_introspection_c__ROS_TYPE_STRING:
+      op->kind = OP_STRINGS;
+      return true;
+    case rosidl_typesupport_introspection_c__ROS_TYPE_WSTRING:
+      op->kind = OP_WSTRINGS;
+      return true;
+    case rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE:
+      op->kind = OP_MESSAGES;
+      op->sub = get_plan(static_cast<const MembersT *>(member->members_->data));
+      return nullptr != op->sub;
+    default:
+      op->kind = OP_PRIMITIVES;
+      if (0 == op->stride) {
+        RMW_SET_ERROR_MSG("Serializing unknown type");
+        return false;
+      }
+      return true;
+  }
+}
+
+// Append the ops for a message of type members, placed offset bytes into the outermost message
+template<typename MembersT>
+bool
+emit_struct(std::vector<plan_op_t> & ops, const MembersT * members, size_t offset)
+{
+  for (uint32_t i = 0; i < members->member_count_; i++) {
+    const typename Flavour<MembersT>::Member * member = members->members_ + i;
+    plan_op_t op;
+    memset(&op, 0, sizeof(op));
+    op.offset = offset + member->offset_;
+    op.bound = member->string_upper_bound_;
+
+    // A single nested message is just more fields
+    if (rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE == member->type_id_ &&
+      !member->is_array_)
+    {
+      if (!emit_struct(ops, static_cast<const MembersT *>(member->members_->data), op.offset)) {
+        return false;
+      }
+      continue;
+    }
+
+    if (!describe_element<MembersT>(member, &op)) {
+      return false;
+    }
+    if (member->is_array_ && (0 == member->array_size_ || member->is_upper_bound_)) {
+      op.elem_kind = op.kind;
+      op.kind = OP_SEQUENCE;
+      op.member = member;
+      op.bound = member->is_upper_bound_ ? member->array_size_ : 0;
+    } else {
+      op.count = member->is_array_ ? member->array_size_ : 1;
+    }
+    ops.push_back(op);
+  }
+  return true;
+}
+
+// Primitives that are stored exactly as CDR encodes them, naturally aligned
+inline bool
+is_runnable(const plan_op_t & op)
+{
+  return OP_PRIMITIVES == op.kind &&
+         rosidl_typesupport_introspection_c__ROS_TYPE_LONG_DOUBLE != op.type_id;
+}
+
+template<typename MembersT>
+serialization_plan_t *
+build_plan(const MembersT * members)
+{
+  std::vector<plan_op_t> ops;
+  if (!emit_struct(ops, members, 0)) {
+    return nullptr;
+  }
+
+  // At most one OP_RUN per op
+  serialization_plan_t * plan = static_cast<serialization_plan_t *>(
+    rmw_allocate(sizeof(serialization_plan_t) + 2 * ops.size() * sizeof(plan_op_t)));
+  if (nullptr == plan) {
+    return nullptr;
+  }
+  plan->members = members;
+  plan->next = nullptr;
+  plan->count = 0;
+  plan->ops = reinterpret_cast<plan_op_t *>(plan + 1);
+
+  // Group consecutive primitives where the padding between them in memory is exactly what CDR
+  // would insert, ie each starts at the next offset aligned to its size
+  for (size_t i = 0; i < ops.size(); ) {
+    size_t end = i + 1;
+    if (is_runnable(ops[i])) {
+      size_t run_end = ops[i].offset + ops[i].count * ops[i].stride;
+      while (end < ops.size() && is_runnable(ops[end])) {
+        const plan_op_t & next = ops[end];
+        size_t aligned = (run_end + next.stride - 1) & ~(next.stride - 1);
+        if (next.offset != aligned) {
+          break;
+        }
+        run_end = next.offset + next.count * next.stride;
+        end++;
+      }
+      if (end - i > 1) {
+        plan_op_t run;
+        memset(&run, 0, sizeof(run));
+        run.kind = OP_RUN;
+        run.offset = ops[i].offset;
+        run.count = run_end - run.offset;
+        run.skip = end - i;
+        plan->ops[plan->count++] = run;
+      }
+    }
+    for (; i < end; i++) {
+      plan->ops[plan->count++] = ops[i];
+    }
+  }
+
+  return plan;
+}
+
+template<typename MembersT>
+const serialization_plan_t *
+get_plan(const MembersT * members)
+{
+  std::atomic<serialization_plan_t *> & bucket =
+    plan_cache[(reinterpret_cast<uintptr_t>(members) >> 4) % kPlanCacheBuckets];
+  serialization_plan_t * head = bucket.load(std::memory_order_acquire);
+  for (serialization_plan_t * plan = head; nullptr != plan; plan = plan->next) {
+    if (plan->members == members) {
+      return plan;
+    }
+  }
+
+  serialization_plan_t * plan = build_plan(members);
+  if (nullptr == plan) {
+    RMW_SET_ERROR_MSG("Unable to build serialization plan");
+    return nullptr;
+  }
+
+  // Push it, unless another thread gets the same type in first
+  plan->next = head;
+  while (!bucket.compare_exchange_weak(
+      plan->next, plan, std::memory_order_acq_rel, std::memory_order_acquire))
+  {
+    for (serialization_plan_t * other = plan->next; other != head; other = other->next) {
+      if (other->members == members) {
+        rmw_free(plan);
+        return other;
+      }
+    }
+    head = plan->next;
+  }
+  return plan;
+}
+
+// A run can be copied as is if the stream is in machine byte order, and it's at the same
+// position relative to an 8 byte boundary as the run is in memory
+inline bool
+run_fits(const ucdrBuffer * buffer, const uint8_t * data)
+{
+  return UCDR_MACHINE_ENDIANNESS == buffer->endianness &&
+         (ucdr_buffer_length(buffer) & 7) == (reinterpret_cast<uintptr_t>(data) & 7);
+}
+
+template<typename MembersT>
+bool
+serialize_plan(ucdrBuffer * writer, const serialization_plan_t * plan, const uint8_t * ros_message);
+
+template<typename MembersT>
+bool
+deserialize_plan(ucdrBuffer * reader, const serialization_plan_t * plan, uint8_t * ros_message);
+
+// Encode count consecutive elements, described by op, starting at data
+template<typename MembersT>
+bool
+serialize_elements(
+  ucdrBuffer * writer, plan_op_kind_t kind, const plan_op_t * op, const uint8_t * data,
+  size_t count)
+{
+  bool ok = true;
+  switch (kind) {
+    case OP_STRINGS:
+      for (size_t i = 0; ok && i < count; i++) {
+        ok = Flavour<MembersT>::serialize_string(writer, data + i * op->stride);
+      }
+      return ok;
+    case OP_WSTRINGS:
+      for (size_t i = 0; ok && i < count; i++) {
+        ok = Flavour<MembersT>::serialize_wstring(writer, data + i * op->stride);
+      }
+      return ok;
+    case OP_MESSAGES:
+      for (size_t i = 0; ok && i < count; i++) {
+        ok = serialize_plan<MembersT>(writer, op->sub, data + i * op->stride);
+      }
+      return ok;
+    default:
+      return serialize_primitives(writer, op->type_id, data, count);
+  }
+}
+
+// Decode count consecutive elements, described by op, into data, which must be initialized
+template<typename MembersT>
+bool
+deserialize_elements(
+  ucdrBuffer * reader, plan_op_kind_t kind, const plan_op_t * op, uint8_t * data, size_t count)
+{
+  bool ok = true;
+  switch (kind) {
+    case OP_STRINGS:
+      for (size_t i = 0; ok && i < count; i++) {
+        ok = Flavour<MembersT>::deserialize_string(reader, data + i * op->stride, op->bound);
+      }
+      return ok;
+    case OP_WSTRINGS:
+      for (size_t i = 0; ok && i < count; i++) {
+        ok = Flavour<MembersT>::deserialize_wstring(reader, data + i * op->stride, op->bound);
+      }
+      return ok;
+    case OP_MESSAGES:
+      for (size_t i = 0; ok && i < count; i++) {
+        ok = deserialize_plan<MembersT>(reader, op->sub, data + i * op->stride);
+      }
+      return ok;
+    default:
+      return deserialize_primitives(reader, op->type_id, data, count);
+  }
+}
+
+// Fixed size arrays are encoded as their elements. Sequences are prefixed with their length
+template<typename MembersT>
+bool
+serialize_plan(ucdrBuffer * writer, const serialization_plan_t * plan, const uint8_t * ros_message)
+{
+  typedef Flavour<MembersT> F;
+  for (size_t i = 0; i < plan->count; i++) {
+    const plan_op_t * op = plan->ops + i;
+    const uint8_t * field = ros_message + op->offset;
+    switch (op->kind) {
+      case OP_RUN:
+        if (run_fits(writer, field)) {
+          if (!ucdr_serialize_array_uint8_t(writer, field, op->count)) {
+            return false;
+          }
+          i += op->skip;
+        }
+        break;
+      case OP_SEQUENCE: {
+          const typename F::Member * member = static_cast<const typename F::Member *>(op->member);
+          size_t size = F::sequence_size(member, field);
+          if (!ucdr_serialize_uint32_t(writer, (uint32_t)size)) {
+            return false;
+          }
+          if (F::is_bit_vector(member)) {
+            if (!F::serialize_bits(writer, field)) {
+              return false;
+            }
+            break;
+          }
+          const uint8_t * data = static_cast<const uint8_t *>(F::sequence_data(member, field));
+          if (!serialize_elements<MembersT>(writer, op->elem_kind, op, data, size)) {
+            return false;
+          }
+          break;
+        }
+      default:
+        if (!serialize_elements<MembersT>(writer, op->kind, op, field, op->count)) {
+          return false;
+        }
+        break;
+    }
+  }
+  return true;
+}
+
+template<typename MembersT>
+bool
+deserialize_plan(ucdrBuffer * reader, const serialization_plan_t * plan, uint8_t * ros_message)
+{
+  typedef Flavour<MembersT> F;
+  for (size_t i = 0; i < plan->count; i++) {
+    const plan_op_t * op = plan->ops + i;
+    uint8_t * field = ros_message + op->offset;
+    switch (op->kind) {
+      case OP_RUN:
+        if (run_fits(reader, field)) {
+          if (!ucdr_deserialize_array_uint8_t(reader, field, op->count)) {
+            return false;
+          }
+          i += op->skip;
+        }
+        break;
+      case OP_SEQUENCE: {
+          // Every element takes at least a byte, which bounds the length of an honest sequence
+          const typename F::Member * member = static_cast<const typename F::Member *>(op->member);
+          uint32_t count;
+          if (!ucdr_deserialize_uint32_t(reader, &count)) {
+            return false;
+          }
+          if ((0 != op->bound && count > op->bound) || count > ucdr_buffer_remaining(reader)) {
+            RMW_SET_ERROR_MSG("Serialized message has a malformed sequence");
+            return false;
+          }
+          if (!F::resize_sequence(member, field, count)) {
+            RMW_SET_ERROR_MSG("Unable to resize sequence");
+            return false;
+          }
+          if (F::is_bit_vector(member)) {
+            if (!F::deserialize_bits(reader, field, count)) {
+              return false;
+            }
+            break;
+          }
+          uint8_t * data = static_cast<uint8_t *>(F::sequence_data(member, field));
+          if (!deserialize_elements<MembersT>(reader, op->elem_kind, op, data, count)) {
+            return false;
+          }
+          break;
+        }
+      default:
+        if (!deserialize_elements<MembersT>(reader, op->kind, op, field, op->count)) {
+          return false;
+        }
+        break;
+    }
+  }
+  return true;
+}
+
+template<typename MembersT>
+rmw_ret_t
+serialize_message(
+  const MembersT * members,
+  const void * ros_message,
+  rmw_serialized_message_t * serialized_message)
+{
+  const serialization_plan_t * plan = get_plan(members);
+  if (nullptr == plan) {
+    return RMW_RET_BAD_ALLOC;
+  }
+
+  // The encoding is never much larger than the message struct, except for what strings and
+  // sequences hold, so start there and grow if microcdr runs out of room
+  size_t capacity = serialized_message->buffer_capacity;
+  if (capacity < ENCAPSULATION_SIZE + members->size_of_) {
+    capacity = ENCAPSULATION_SIZE + members->size_of_;
+  }
+  for (;; ) {
+    rmw_ret_t ret;
+    if (capacity > serialized_message->buffer_capacity) {
+      if (RMW_RET_OK != (ret = rmw_serialized_message_resize(serialized_message, capacity))) {
+        RMW_SET_ERROR_MSG("Cannot resize serialized message");
+        return ret;
+      }
+    }
+
+    // Alignment is relative to the end of the encapsulation header
+    uint8_t * buffer = serialized_message->buffer;
+    buffer[0] = 0x00;
+    buffer[1] = (UCDR_LITTLE_ENDIANNESS == UCDR_MACHINE_ENDIANNESS) ? CDR_LE : CDR_BE;
+    buffer[2] = 0x00;
+    buffer[3] = 0x00;
+    ucdrBuffer writer;
+    ucdr_init_buffer(
+      &writer, buffer + ENCAPSULATION_SIZE,
+      serialized_message->buffer_capacity - ENCAPSULATION_SIZE);
+
+    bool ok = serialize_plan<MembersT>(
+      &writer, plan, static_cast<const uint8_t *>(ros_message));
+    if (!writer.error) {
+      if (!ok) {
+        return RMW_RET_ERROR;
+      }
+      serialized_message->buffer_length = ENCAPSULATION_SIZE + ucdr_buffer_length(&writer);
+      return RMW_RET_OK;
+    }
+    capacity = 2 * serialized_message->buffer_capacity;
+  }
+}
+
+template<typename MembersT>
+rmw_ret_t
+deserialize_message(
+  const MembersT * members,
+  const rmw_serialized_message_t * serialized_message,
+  void * ros_message)
+{
+  const serialization_plan_t * plan = get_plan(members);
+  if (nullptr == plan) {
+    return RMW_RET_BAD_ALLOC;
+  }
+  if (serialized_message->buffer_length < ENCAPSULATION_SIZE) {
+    RMW_SET_ERROR_MSG("Serialized message is truncated");
+    return RMW_RET_ERROR;
+  }
+
+  ucdrBuffer reader;
+  ucdr_init_buffer(
+    &reader, serialized_message->buffer + ENCAPSULATION_SIZE,
+    serialized_message->buffer_length - ENCAPSULATION_SIZE);
+  reader.endianness = (serialized_message->buffer[1] & CDR_LE) ?
+    UCDR_LITTLE_ENDIANNESS : UCDR_BIG_ENDIANNESS;
+
+  bool ok = deserialize_plan<MembersT>(&reader, plan, static_cast<uint8_t *>(ros_message));
+  if (reader.error) {
+    RMW_SET_ERROR_MSG("Serialized message is truncated");
+    return RMW_RET_ERROR;
+  }
+  return ok ? RMW_RET_OK : RMW_RET_ERROR;
+}
+
+}  // namespace
+
+rmw_ret_t
+hazcat_serialize(
+  const type_info_t * type,
+  const void * ros_message,
+  rmw_serialized_message_t * serialized_message)
+{
+  if (type->is_cpp) {
+    return serialize_message(
+      static_cast<const CppMembers *>(type->introspection->data), ros_message, serialized_message);
+  }
+  return serialize_message(
+    static_cast<const CMembers *>(type->introspection->data), ros_message, serialized_message);
+}
+
+rmw_ret_t
+hazcat_deserialize(
+  const type_info_t * type,
+  const rmw_serialized_message_t * serialized_message,
+  void * ros_message)
+{
+  if (type->is_cpp) {
+    return deserialize_message(
+      static_cast<const CppMembers *>(type->introspection->data), serialized_message, ros_message);
+  }
+  return deserialize_message(
+    static_cast<const CMembers *>(type->introspection->data), serialized_message, ros_message);
+}
+
+rmw_ret_t
+rmw_serialize(
+  const void * ros_message,
+  const rosidl_message_type_support_t * type_support,
+  rmw_serialized_message_t * serialized_message)
+{
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(ros_message, RMW_RET_INVALID_ARGUMENT);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(type_support, RMW_RET_INVALID_ARGUMENT);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(serialized_message, RMW_RET_INVALID_ARGUMENT);
+
+  const type_info_t * info = hazcat_type_info(type_support);
+  if (nullptr == info) {
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  return hazcat_serialize(info, ros_message, serialized_message);
+}
+
+rmw_ret_t
+rmw_deserialize(
+  const rmw_serialized_message_t * serialized_message,
+  const rosidl_message_type_support_t * type_support,
+  void * ros_message)
+{
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(ros_message, RMW_RET_INVALID_ARGUMENT);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(type_support, RMW_RET_INVALID_ARGUMENT);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(serialized_message, RMW_RET_INVALID_ARGUMENT);
+
+  const type_info_t * info = hazcat_type_info(type_support);
+  if (nullptr == info) {
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  return hazcat_deserialize(info, serialized_message, ros_message);
+}
+
+rmw_ret_t
+rmw_get_serialized_message_size(
+  const rosidl_message_type_support_t * type_support,
+  const rosidl_runtime_c__Sequence__bound * message_bounds,
+  size_t * size)
+{
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(type_support, RMW_RET_INVALID_ARGUMENT);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(message_bounds, RMW_RET_INVALID_ARGUMENT);
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(size, RMW_RET_INVALID_ARGUMENT);
+
+  const type_info_t * info = hazcat_type_info(type_support);
+  if (nullptr == info) {
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  *size = info->size;
+
+  return RMW_RET_OK;
+}
@@ -21,10 +21,115 @@
 
 #include "hazcat/hazcat_message_queue.h"
 
+#include "rmw_hazcat/hazcat_publisher.h"
+#include "rmw_hazcat/hazcat_service.h"
+#include "rmw_hazcat/hazcat_subscription.h"
+#include "rmw_hazcat/hazcat_typesupport.h"
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
+
+_Static_assert(
+  sizeof(gid_layout_t) <= sizeof(((rmw_request_id_t *)0)->writer_guid),
+  "gid doesn't fit a request id");
+
+// Prefixes and suffixes are those DDS based rmws use, and make the names invalid as ROS topics
+char *
+hazcat_request_topic(const char * service_name)
+{
+  size_t len = strlen("rq") + strlen(service_name) + strlen("Request") + 1;
+  char * topic = rmw_allocate(len);
+  if (NULL != topic) {
+    snprintf(topic, len, "rq%sRequest", service_name);
+  }
+  return topic;
+}
+
+char *
+hazcat_response_topic(const char * service_name, const gid_layout_t * client)
+{
+  size_t len = strlen("rr") + strlen(service_name) + strlen("Reply/") + 4 * 8 + 1;
+  char * topic = rmw_allocate(len);
+  if (NULL != topic) {
+    snprintf(
+      topic, len, "rr%sReply/%08x%08x%08x%08x", service_name,
+      client->host, client->pid, client->nonce, client->count);
+  }
+  return topic;
+}
+
+// Destroy the publishers of responders whose client is gone, which is when nothing subscribes to
+// their response topic anymore. Clients subscribe before they send their first request, so a
+// responder is never reclaimed before the client it answers has been destroyed. Call with lock held
+static void
+reclaim_responders(service_info_t * info)
+{
+  size_t i = 0;
+  while (i < info->responder_count) {
+    const pub_sub_data_t * data = info->responders[i].pub->data;
+    if (0 < __atomic_load_n(&data->mq->elem->sub_count, __ATOMIC_ACQUIRE)) {
+      i++;
+      continue;
+    }
+    if (RMW_RET_OK != rmw_destroy_publisher((rmw_node_t *)info->node, info->responders[i].pub)) {
+      // Try again next time
+      rmw_reset_error();
+      i++;
+      continue;
+    }
+    info->responders[i] = info->responders[--info->responder_count];
+  }
+}
+
+// Publisher on the response topic of client, created the first time client is answered. Creating
+// one first reclaims those of clients that are gone, so a long running service holds one per live
+// client rather than one per client it ever answered. Call with lock held, and keep holding it
+// while using the publisher, since it may be reclaimed as soon as it's released
+static rmw_publisher_t *
+get_responder(service_info_t * info, const char * service_name, const gid_layout_t * client)
+{
+  for (size_t i = 0; i < info->responder_count; i++) {
+    if (0 == memcmp(&info->responders[i].client, client, sizeof(gid_layout_t))) {
+      return info->responders[i].pub;
+    }
+  }
+
+  reclaim_responders(info);
+  if (info->responder_count == info->responder_capacity) {
+    size_t capacity = (0 == info->responder_capacity) ? 4 : 2 * info->responder_capacity;
+    responder_t * responders = rmw_allocate(capacity * sizeof(responder_t));
+    if (NULL == responders) {
+      RMW_SET_ERROR_MSG("Unable to allocate memory for responders");
+      return NULL;
+    }
+    if (NULL != info->responders) {
+      memcpy(responders, info->responders, info->responder_count * sizeof(responder_t));
+      rmw_free(info->responders);
+    }
+    info->responders = responders;
+    info->responder_capacity = capacity;
+  }
+
+  char * topic = hazcat_response_topic(service_name, client);
+  if (NULL == topic) {
+    RMW_SET_ERROR_MSG("Unable to allocate string for response topic");
+    return NULL;
+  }
+  rmw_publisher_options_t options = rmw_get_default_publisher_options();
+  rmw_publisher_t * pub =
+    rmw_create_publisher(info->node, info->response_type, topic, &info->qos, &options);
+  rmw_free(topic);
+  if (NULL != pub) {
+    info->responders[info->responder_count].client = *client;
+    info->responders[info->responder_count].pub = pub;
+    info->responder_count++;
+  }
+
+  return pub;
+}
+
 rmw_service_t *
 rmw_create_service(
   const rmw_node_t * node,
@@ -56,32 +161,64 @@ rmw_create_service(
     return NULL;
   }
 
-  // rmw_ret_t ret;
-  // size_t msg_size;
-  // rosidl_runtime_c__Sequence__bound dummy;
-  // if (ret = rmw_get_serialized_message_size(type_support, &dummy, &msg_size) != RMW_RET_OK) {
-  //   RMW_SET_ERROR_MSG("Unable to get serialized message size");
-  //   return NULL;
-  // }
+  const service_type_info_t * types = hazcat_service_type_info(type_support);
+  if (NULL == types) {
+    return NULL;
+  }
 
   rmw_service_t * srv = rmw_service_allocate();
   if (NULL == srv) {
     RMW_SET_ERROR_MSG("Unable to allocate memory for service");
     return NULL;
   }
+  service_info_t * info = rmw_allocate(sizeof(service_info_t));
+  if (NULL == info) {
+    RMW_SET_ERROR_MSG("Unable to allocate memory for service info");
+    rmw_service_free(srv);
+    return NULL;
+  }
+
+  // The endpoints' topics are private, and deliberately not valid ROS names
+  info->node = node;
+  info->response_type = types->response;
+  info->qos = *qos_policies;
+  info->qos.avoid_ros_namespace_conventions = true;
+  info->responder_count = 0;
+  info->responder_capacity = 0;
+  info->responders = NULL;
+  pthread_mutex_init(&info->lock, NULL);
+
+  char * topic = hazcat_request_topic(service_name);
+  if (NULL == topic) {
+    RMW_SET_ERROR_MSG("Unable to allocate string for request topic");
+    goto fail;
+  }
+  rmw_subscription_options_t options = rmw_get_default_subscription_options();
+  info->requests = rmw_create_subscription(node, types->request, topic, &info->qos, &options);
+  rmw_free(topic);
+  if (NULL == info->requests) {
+    goto fail;
+  }
+  ((subscription_info_t *)info->requests->data)->count_lost = false;
 
-  size_t len = strlen(service_name);
   srv->implementation_identifier = rmw_get_implementation_identifier();
-  srv->data = rmw_allocate(sizeof(srv_clt_data_t));
+  srv->data = info;
   srv->service_name = rmw_allocate(strlen(service_name) + 1);
 
   if (NULL == srv->service_name) {
-    RMW_SET_ERROR_MSG("Unable to allocate string for subscription's topic name");
-    return NULL;
+    RMW_SET_ERROR_MSG("Unable to allocate string for service's name");
+    rmw_destroy_subscription((rmw_node_t *)node, info->requests);
+    goto fail;
   }
   snprintf(srv->service_name, strlen(service_name) + 1, service_name);
 
   return srv;
+
+fail:
+  pthread_mutex_destroy(&info->lock);
+  rmw_free(info);
+  rmw_service_free(srv);
+  return NULL;
 }
 
 rmw_ret_t
@@ -96,11 +233,26 @@ rmw_destroy_service(rmw_node_t * node, rmw_service_t * service)
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
 
-  rmw_free(service->data);
+  service_info_t * info = service->data;
+  rmw_ret_t ret = RMW_RET_OK;
+  for (size_t i = 0; i < info->responder_count; i++) {
+    rmw_ret_t pub_ret = rmw_destroy_publisher(node, info->responders[i].pub);
+    if (RMW_RET_OK != pub_ret) {
+      ret = pub_ret;
+    }
+  }
+  rmw_ret_t sub_ret = rmw_destroy_subscription(node, info->requests);
+  if (RMW_RET_OK != sub_ret) {
+    ret = sub_ret;
+  }
+  pthread_mutex_destroy(&info->lock);
+
+  rmw_free(info->responders);
+  rmw_free(info);
   rmw_free(service->service_name);
   rmw_service_free(service);
 
-  return RMW_RET_OK;
+  return ret;
 }
 
 rmw_ret_t
@@ -114,9 +266,25 @@ rmw_take_request(
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(request_header, RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(ros_request, RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(taken, RMW_RET_INVALID_ARGUMENT);
+  if (service->implementation_identifier != rmw_get_implementation_identifier()) {
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
+  }
 
-  RMW_SET_ERROR_MSG("rmw_take_request hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  service_info_t * info = service->data;
+  rmw_message_info_t message_info;
+  rmw_ret_t ret = rmw_take_with_info(info->requests, ros_request, taken, &message_info, NULL);
+  if (RMW_RET_OK != ret || !*taken) {
+    return ret;
+  }
+
+  request_header->source_timestamp = message_info.source_timestamp;
+  request_header->received_timestamp = message_info.received_timestamp;
+  memset(request_header->request_id.writer_guid, 0, sizeof(request_header->request_id.writer_guid));
+  memcpy(
+    request_header->request_id.writer_guid, message_info.publisher_gid.data, sizeof(gid_layout_t));
+  request_header->request_id.sequence_number = (int64_t)message_info.publication_sequence_number;
+
+  return RMW_RET_OK;
 }
 
 rmw_ret_t
@@ -128,9 +296,22 @@ rmw_send_response(
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(service, RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(request_header, RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(ros_response, RMW_RET_INVALID_ARGUMENT);
+  if (service->implementation_identifier != rmw_get_implementation_identifier()) {
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
+  }
+
+  service_info_t * info = service->data;
+  gid_layout_t client;
+  memcpy(&client, request_header->writer_guid, sizeof(client));
+  pthread_mutex_lock(&info->lock);
+  rmw_publisher_t * pub = get_responder(info, service->service_name, &client);
+  rmw_ret_t ret = RMW_RET_ERROR;
+  if (NULL != pub) {
+    ret = hazcat_publisher_publish(pub, ros_response, (uint64_t)request_header->sequence_number);
+  }
+  pthread_mutex_unlock(&info->lock);
 
-  RMW_SET_ERROR_MSG("rmw_send_response hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  return ret;
 }
 
 rmw_ret_t
@@ -142,9 +323,18 @@ rmw_service_server_is_available(
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(node, RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(client, RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(is_available, RMW_RET_INVALID_ARGUMENT);
+  if (node->implementation_identifier != rmw_get_implementation_identifier()) {
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
+  }
+  if (client->implementation_identifier != rmw_get_implementation_identifier()) {
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
+  }
 
-  RMW_SET_ERROR_MSG("rmw_service_server_is_available hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  // A server is a subscriber on the request topic
+  const pub_sub_data_t * requests = ((client_info_t *)client->data)->requests->data;
+  *is_available = 0 < __atomic_load_n(&requests->mq->elem->sub_count, __ATOMIC_ACQUIRE);
+
+  return RMW_RET_OK;
 }
 #ifdef __cplusplus
 }
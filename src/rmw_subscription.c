@@ -21,16 +21,192 @@
 #include "rmw/get_topic_names_and_types.h"
 #include "rmw/names_and_types.h"
 #include "rmw/sanity_checks.h"
+#include "rmw/validate_full_topic_name.h"
 #include "rmw/validate_namespace.h"
 #include "rmw/validate_node_name.h"
 
+#include "rosidl_runtime_c/message_initialization.h"
+
 #include "hazcat_allocators/cpu_ringbuf_allocator.h"
 #include "hazcat/hazcat_message_queue.h"
 
+#include "rmw_hazcat/hazcat_gid.h"
+#include "rmw_hazcat/hazcat_message.h"
+#include "rmw_hazcat/hazcat_node.h"
+#include "rmw_hazcat/hazcat_ros_graph.h"
+#include "rmw_hazcat/hazcat_serialize.h"
+#include "rmw_hazcat/hazcat_subscription.h"
+#include "rmw_hazcat/hazcat_typesupport.h"
+#include "rmw_hazcat/hazcat_wait_set.h"
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
+
+// Count the messages from header's publisher that went by since the last one taken from it
+static void
+count_lost(subscription_info_t * info, const message_header_t * header)
+{
+  publisher_sequence_t * tracked = NULL;
+  for (size_t i = 0; i < HAZCAT_TRACKED_PUBLISHERS; i++) {
+    if (0 != info->publishers[i].sequence_number &&
+      0 == memcmp(&info->publishers[i].gid, &header->publisher_gid, sizeof(gid_layout_t)))
+    {
+      tracked = &info->publishers[i];
+      break;
+    }
+  }
+
+  if (NULL == tracked) {
+    // First message taken from this publisher, there's nothing to compare it with yet
+    tracked = &info->publishers[info->next_tracked];
+    info->next_tracked = (info->next_tracked + 1) % HAZCAT_TRACKED_PUBLISHERS;
+    tracked->gid = header->publisher_gid;
+  } else if (header->sequence_number > tracked->sequence_number + 1) {
+    __atomic_fetch_add(
+      &info->lost, header->sequence_number - tracked->sequence_number - 1, __ATOMIC_RELEASE);
+  }
+  tracked->sequence_number = header->sequence_number;
+}
+
+// Take the next message from the queue this subscription wants, if any, and fill message_info
+// from its header if message_info isn't NULL. The returned msg points past the header
+static msg_ref_t
+take_next(subscription_info_t * info, rmw_message_info_t * message_info)
+{
+  msg_ref_t msg_ref;
+  message_header_t * header;
+  for (;; ) {
+    msg_ref = hazcat_take(&info->data);
+    if (NULL == msg_ref.msg) {
+      return msg_ref;
+    }
+    header = (message_header_t *)msg_ref.msg;
+    if (info->count_lost) {
+      count_lost(info, header);
+    }
+    if (0 != info->deadline.period) {
+      hazcat_event_timer_restart(&info->deadline, hazcat_monotonic_now());
+    }
+    if (!info->ignore_local || !hazcat_gid_is_local(&header->publisher_gid)) {
+      break;
+    }
+    int offset = PTR_TO_OFFSET(msg_ref.alloc, msg_ref.msg);
+    DEALLOCATE(msg_ref.alloc, offset);
+  }
+  msg_ref.msg = (uint8_t *)msg_ref.msg + HAZCAT_MESSAGE_HEADER_SIZE;
+
+  uint64_t reception_sequence_number = __atomic_add_fetch(&info->received, 1, __ATOMIC_RELAXED);
+  if (NULL != message_info) {
+    message_info->source_timestamp = header->source_timestamp;
+    message_info->received_timestamp = hazcat_now();
+    message_info->publication_sequence_number = header->sequence_number;
+    message_info->reception_sequence_number = reception_sequence_number;
+    message_info->publisher_gid.implementation_identifier = rmw_get_implementation_identifier();
+    memset(message_info->publisher_gid.data, 0, RMW_GID_STORAGE_SIZE);
+    memcpy(message_info->publisher_gid.data, &header->publisher_gid, sizeof(gid_layout_t));
+    message_info->from_intra_process = false;
+  }
+
+  return msg_ref;
+}
+
+// Give a message returned by take_next back to its allocator
+static void
+release_message(msg_ref_t msg_ref)
+{
+  int offset = PTR_TO_OFFSET(msg_ref.alloc, hazcat_message_header(msg_ref.msg));
+  DEALLOCATE(msg_ref.alloc, offset);
+}
+
+// Copy a message out of shared memory. Packed strings and sequences are copied into the
+// message's own storage
+static rmw_ret_t
+copy_message(const subscription_info_t * info, const void * msg, void * ros_message)
+{
+  if (info->is_flat) {
+    memcpy(ros_message, msg, info->data.msg_size - HAZCAT_MESSAGE_HEADER_SIZE);
+    return RMW_RET_OK;
+  }
+  return hazcat_message_unpack(info->members, msg, ros_message);
+}
+
+// Take the next message from the queue, if any, copy it into ros_message, and release it
+static rmw_ret_t
+take_message(
+  subscription_info_t * info, void * ros_message, bool * taken, rmw_message_info_t * message_info)
+{
+  msg_ref_t msg_ref = take_next(info, message_info);
+  if (NULL == msg_ref.msg) {
+    *taken = false;
+    return RMW_RET_OK;
+  }
+  *taken = true;
+
+  rmw_ret_t ret = copy_message(info, msg_ref.msg, ros_message);
+  release_message(msg_ref);
+
+  return ret;
+}
+
+// Encode a message in shared memory as CDR. Flat messages, C++ ones included, are serialized in
+// place. Packed ones are unpacked first, into scratch if it isn't NULL, since the serializer
+// follows pointers rather than the offsets they're packed with
+static rmw_ret_t
+serialize_message(
+  const subscription_info_t * info, const void * msg, void * scratch,
+  rmw_serialized_message_t * serialized_message)
+{
+  if (info->is_flat) {
+    return hazcat_serialize(info->type, msg, serialized_message);
+  }
+
+  if (NULL != scratch) {
+    rmw_ret_t ret = hazcat_message_unpack(info->members, msg, scratch);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+    return hazcat_serialize(info->type, scratch, serialized_message);
+  }
+
+  void * ros_message = rmw_allocate(info->members->size_of_);
+  if (NULL == ros_message) {
+    RMW_SET_ERROR_MSG("unable to allocate memory for message");
+    return RMW_RET_BAD_ALLOC;
+  }
+  info->members->init_function(ros_message, ROSIDL_RUNTIME_C_MSG_INIT_ALL);
+  rmw_ret_t ret = hazcat_message_unpack(info->members, msg, ros_message);
+  if (RMW_RET_OK == ret) {
+    ret = hazcat_serialize(info->type, ros_message, serialized_message);
+  }
+  info->members->fini_function(ros_message);
+  rmw_free(ros_message);
+
+  return ret;
+}
+
+// Take the next message from the queue, if any, encode it into serialized_message, and release it
+static rmw_ret_t
+take_serialized(
+  subscription_info_t * info, rmw_serialized_message_t * serialized_message, bool * taken,
+  rmw_message_info_t * message_info, const rmw_subscription_allocation_t * allocation)
+{
+  msg_ref_t msg_ref = take_next(info, message_info);
+  if (NULL == msg_ref.msg) {
+    *taken = false;
+    return RMW_RET_OK;
+  }
+  *taken = true;
+
+  void * scratch = hazcat_allocation_scratch(
+    (NULL == allocation) ? NULL : allocation->data, info->members);
+  rmw_ret_t ret = serialize_message(info, msg_ref.msg, scratch, serialized_message);
+  release_message(msg_ref);
+
+  return ret;
+}
+
 rmw_ret_t
 rmw_init_subscription_allocation(
   const rosidl_message_type_support_t * type_supports,
@@ -41,17 +217,28 @@ rmw_init_subscription_allocation(
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(message_bounds, RMW_RET_INVALID_ARGUMENT);
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
 
-  RMW_SET_ERROR_MSG("rmw_init_subscription_allocation hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  allocation_info_t * data;
+  rmw_ret_t ret = hazcat_allocation_init(type_supports, &data);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+  allocation->data = data;
+  allocation->implementation_identifier = rmw_get_implementation_identifier();
+
+  return RMW_RET_OK;
 }
 
 rmw_ret_t
 rmw_fini_subscription_allocation(rmw_subscription_allocation_t * allocation)
 {
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
+  HAZCAT_CHECK_ALLOCATION(allocation);
+
+  hazcat_allocation_fini(allocation->data);
+  allocation->implementation_identifier = NULL;
+  allocation->data = NULL;
 
-  RMW_SET_ERROR_MSG("rmw_fini_subscription_allocation hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  return RMW_RET_OK;
 }
 
 rmw_subscription_t *
@@ -94,30 +281,63 @@ rmw_create_subscription(
     RMW_SET_ERROR_MSG("Unable to get serialized message size");
     return NULL;
   }
+  const type_info_t * type = hazcat_type_info(type_supports);
+  if (NULL == type) {
+    return NULL;
+  }
+  // Only C messages can have their strings and sequences packed into shared memory. C++ ones would
+  // be copied with pointers into the heap of the process that published them
+  if (type->is_cpp && !type->is_pod) {
+    RMW_SET_ERROR_MSG("C++ messages with strings or sequences aren't supported by rmw_hazcat");
+    return NULL;
+  }
+  const rosidl_typesupport_introspection_c__MessageMembers * members =
+    hazcat_message_members(type_supports);
+  bool is_flat = type->is_pod;
 
   rmw_subscription_t * sub = rmw_subscription_allocate();
   if (NULL == sub) {
     RMW_SET_ERROR_MSG("Unable to allocate memory for subscription");
     return NULL;
   }
-  pub_sub_data_t * data = rmw_allocate(sizeof(pub_sub_data_t));
-  if (NULL == data) {
+  subscription_info_t * info = rmw_allocate(sizeof(subscription_info_t));
+  if (NULL == info) {
     RMW_SET_ERROR_MSG("Unable to allocate memory for subscription info");
     return NULL;
   }
+  info->type = type;
+  info->members = members;
+  info->is_flat = is_flat;
+  info->ignore_local = subscription_options->ignore_local_publications;
+  info->count_lost = true;
+  info->received = 0;
+  info->lost = 0;
+  info->lost_reported = 0;
+  info->next_tracked = 0;
+  memset(info->publishers, 0, sizeof(info->publishers));
+  info->qos = *qos_policies;
+  hazcat_event_timer_init(
+    &info->deadline, RMW_EVENT_REQUESTED_DEADLINE_MISSED, sub,
+    hazcat_duration_ns(qos_policies->deadline));
+  hazcat_event_timer_init(&info->liveliness, RMW_EVENT_LIVELINESS_CHANGED, sub, 0);
+  pub_sub_data_t * data = &info->data;
 
   // Populate data->alloc with allocator specified and data->history with qos setting
   data->alloc = (hma_allocator_t *)subscription_options->rmw_specific_subscription_payload;
   if (NULL == data->alloc) {
     // TODO(nightduck): Remove when TLSF allocator is done
-    data->alloc = create_cpu_ringbuf_allocator(msg_size, qos_policies->depth);
+    // Only messages copied in from other domains land here. Ones with unbounded strings or
+    // sequences that outgrow these blocks need an allocator passed in the subscription's options
+    size_t block_size = hazcat_message_block_size(members, is_flat, msg_size);
+    data->alloc = create_cpu_ringbuf_allocator(block_size, qos_policies->depth);
     if (NULL == data->alloc) {
       RMW_SET_ERROR_MSG("Unable to create allocator for subscription");
       return NULL;
     }
   }
   data->depth = qos_policies->depth;
-  data->msg_size = msg_size;
+  data->msg_size = HAZCAT_MESSAGE_HEADER_SIZE + msg_size;
+  data->gid = hazcat_generate_gid();
   data->context = node->context;
   sem_init(&data->lock, 0, 1);
 
@@ -125,7 +345,7 @@ rmw_create_subscription(
   sub->data = data;
   sub->topic_name = rmw_allocate(strlen(topic_name) + 1);
   sub->options = *subscription_options;
-  sub->can_loan_messages = true;
+  sub->can_loan_messages = is_flat;
 
   if (NULL == sub->topic_name) {
     RMW_SET_ERROR_MSG("Unable to allocate string for subscription's topic name");
@@ -137,6 +357,14 @@ rmw_create_subscription(
     return NULL;
   }
 
+  ret = hazcat_graph_add_endpoint(
+    ((node_info_t *)node->data)->graph_slot, GRAPH_SUBSCRIPTION, topic_name, type->type_name,
+    &data->gid, qos_policies, &info->graph_slot);
+  if (RMW_RET_OK != ret) {
+    hazcat_unregister_subscription(sub->data);
+    return NULL;
+  }
+
   return sub;
 }
 
@@ -160,6 +388,16 @@ rmw_destroy_subscription(
     return ret;
   }
 
+  subscription_info_t * info = (subscription_info_t *)subscription->data;
+  ret = hazcat_graph_remove_endpoint(info->graph_slot);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+  hazcat_event_timer_fini(&info->deadline);
+  hazcat_event_timer_fini(&info->liveliness);
+
+  hazcat_wait_set_invalidate();
+
   // Free all allocated memory associated with publisher
   rmw_free(subscription->topic_name);
   rmw_free(subscription->data);
@@ -179,17 +417,17 @@ rmw_subscription_get_actual_qos(
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
 
+  const subscription_info_t * info = (const subscription_info_t *)subscription->data;
   qos->history = RMW_QOS_POLICY_HISTORY_KEEP_LAST;
-  qos->depth = ((pub_sub_data_t *)subscription->data)->depth;
+  qos->depth = info->data.depth;
   qos->reliability = RMW_QOS_POLICY_RELIABILITY_RELIABLE;
   qos->durability = RMW_QOS_POLICY_DURABILITY_VOLATILE;
-  qos->deadline.nsec = 0;
-  qos->deadline.sec = 0;
+  qos->deadline = info->qos.deadline;
   qos->lifespan.nsec = 0;
   qos->lifespan.sec = 0;
-  qos->liveliness = RMW_QOS_POLICY_LIVELINESS_AUTOMATIC;
-  qos->liveliness_lease_duration.nsec = 0;
-  qos->liveliness_lease_duration.sec = 0;
+  qos->liveliness = (RMW_QOS_POLICY_LIVELINESS_MANUAL_BY_TOPIC == info->qos.liveliness) ?
+    RMW_QOS_POLICY_LIVELINESS_MANUAL_BY_TOPIC : RMW_QOS_POLICY_LIVELINESS_AUTOMATIC;
+  qos->liveliness_lease_duration = info->qos.liveliness_lease_duration;
   qos->avoid_ros_namespace_conventions = false;
 
   return RMW_RET_OK;
@@ -208,24 +446,9 @@ rmw_take(
   if (subscription->implementation_identifier != rmw_get_implementation_identifier()) {
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
+  HAZCAT_CHECK_ALLOCATION(allocation);
 
-  // TODO(nightduck): Implement per-message size, in case messages are smaller than upper bound
-  size_t size = ((pub_sub_data_t *)subscription->data)->msg_size;
-
-  msg_ref_t msg_ref = hazcat_take(subscription->data);
-  if (NULL == msg_ref.msg) {
-    *taken = false;
-    return RMW_RET_OK;
-  } else {
-    *taken = true;
-  }
-
-  memcpy(ros_message, msg_ref.msg, size);
-
-  int offset = PTR_TO_OFFSET(msg_ref.alloc, msg_ref.msg);
-  DEALLOCATE(msg_ref.alloc, offset);
-
-  return RMW_RET_OK;
+  return take_message(subscription->data, ros_message, taken, NULL);
 }
 
 rmw_ret_t
@@ -243,27 +466,9 @@ rmw_take_with_info(
   if (subscription->implementation_identifier != rmw_get_implementation_identifier()) {
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
+  HAZCAT_CHECK_ALLOCATION(allocation);
 
-  // TODO(nightduck): Populate message_info
-  (void *)message_info;
-
-  // TODO(nightduck): Implement per-message size, in case messages are smaller than upper bound
-  size_t size = ((pub_sub_data_t *)subscription->data)->msg_size;
-
-  msg_ref_t msg_ref = hazcat_take(subscription->data);
-  if (NULL == msg_ref.msg) {
-    *taken = false;
-    return RMW_RET_OK;
-  } else {
-    *taken = true;
-  }
-
-  memcpy(ros_message, msg_ref.msg, size);
-
-  int offset = PTR_TO_OFFSET(msg_ref.alloc, msg_ref.msg);
-  DEALLOCATE(msg_ref.alloc, offset);
-
-  return RMW_RET_OK;
+  return take_message(subscription->data, ros_message, taken, message_info);
 }
 
 rmw_ret_t
@@ -279,9 +484,9 @@ rmw_take_serialized_message(
   if (subscription->implementation_identifier != rmw_get_implementation_identifier()) {
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
+  HAZCAT_CHECK_ALLOCATION(allocation);
 
-  RMW_SET_ERROR_MSG("rmw_take_serialized_message hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  return take_serialized(subscription->data, serialized_message, taken, NULL, allocation);
 }
 
 rmw_ret_t
@@ -299,9 +504,9 @@ rmw_take_serialized_message_with_info(
   if (subscription->implementation_identifier != rmw_get_implementation_identifier()) {
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
+  HAZCAT_CHECK_ALLOCATION(allocation);
 
-  RMW_SET_ERROR_MSG("rmw_take_serialized_message_with_info hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  return take_serialized(subscription->data, serialized_message, taken, message_info, allocation);
 }
 
 rmw_ret_t
@@ -317,8 +522,12 @@ rmw_take_loaned_message(
   if (subscription->implementation_identifier != rmw_get_implementation_identifier()) {
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
+  if (!((subscription_info_t *)subscription->data)->is_flat) {
+    RMW_SET_ERROR_MSG("Messages with strings or sequences can't be loaned");
+    return RMW_RET_UNSUPPORTED;
+  }
 
-  msg_ref_t msg_ref = hazcat_take(subscription->data);
+  msg_ref_t msg_ref = take_next(subscription->data, NULL);
   *loaned_message = msg_ref.msg;
   if (NULL == *loaned_message) {
     *taken = false;
@@ -347,10 +556,12 @@ rmw_take_loaned_message_with_info(
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
 
-  // TODO(nightduck): Populate message_info
-  (void *)message_info;
+  if (!((subscription_info_t *)subscription->data)->is_flat) {
+    RMW_SET_ERROR_MSG("Messages with strings or sequences can't be loaned");
+    return RMW_RET_UNSUPPORTED;
+  }
 
-  msg_ref_t msg_ref = hazcat_take(subscription->data);
+  msg_ref_t msg_ref = take_next(subscription->data, message_info);
   *loaned_message = msg_ref.msg;
   if (NULL == *loaned_message) {
     *taken = false;
@@ -380,23 +591,12 @@ rmw_return_loaned_message_from_subscription(
     return RMW_RET_ERROR;
   }
 
-  int offset = PTR_TO_OFFSET(alloc, loaned_message);
+  int offset = PTR_TO_OFFSET(alloc, hazcat_message_header(loaned_message));
   DEALLOCATE(alloc, offset);
 
   return RMW_RET_OK;
 }
 
-rmw_ret_t
-rmw_take_event(const rmw_event_t * event_handle, void * event_info, bool * taken)
-{
-  RCUTILS_CHECK_ARGUMENT_FOR_NULL(event_handle, RMW_RET_INVALID_ARGUMENT);
-  RCUTILS_CHECK_ARGUMENT_FOR_NULL(event_info, RMW_RET_INVALID_ARGUMENT);
-  RCUTILS_CHECK_ARGUMENT_FOR_NULL(taken, RMW_RET_INVALID_ARGUMENT);
-
-  RMW_SET_ERROR_MSG("rmw_take_event hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
-}
-
 rmw_ret_t
 rmw_take_sequence(
   const rmw_subscription_t * subscription,
@@ -413,6 +613,7 @@ rmw_take_sequence(
   if (subscription->implementation_identifier != rmw_get_implementation_identifier()) {
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
+  HAZCAT_CHECK_ALLOCATION(allocation);
   if (0u == count) {
     RMW_SET_ERROR_MSG("count cannot be 0");
     return RMW_RET_INVALID_ARGUMENT;
@@ -428,13 +629,18 @@ rmw_take_sequence(
     return RMW_RET_INVALID_ARGUMENT;
   }
 
+  // Take until count messages are taken or the queue runs dry. The queue index wraps, so it can't
+  // say how many are left for a subscriber that has been lapped. Each message is still claimed
+  // with its own hazcat_take and released with its own DEALLOCATE: claiming a batch of entries
+  // and releasing their ref bits at once would need a batched take in hazcat's message queue,
+  // which lives outside this package. All this saves over rmw_take is the per-call overhead
+  subscription_info_t * info = subscription->data;
   *taken = 0;
-  bool taken_flag = false;
+  bool taken_flag = true;
   rmw_ret_t ret = RMW_RET_OK;
-  for (int i = 0; i < count; i++) {
-    ret = rmw_take_with_info(
-      subscription, message_sequence->data[*taken], &taken_flag,
-      &message_info_sequence->data[*taken], allocation);
+  while (*taken < count && taken_flag) {
+    ret = take_message(
+      info, message_sequence->data[*taken], &taken_flag, &message_info_sequence->data[*taken]);
     if (RMW_RET_OK != ret) {
       break;
     }
@@ -462,25 +668,28 @@ rmw_get_subscriptions_info_by_topic(
   if (node->implementation_identifier != rmw_get_implementation_identifier()) {
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
-  int validation_result = RMW_NODE_NAME_VALID;
-  rmw_ret_t ret = rmw_validate_node_name(topic_name, &validation_result, NULL);
-  if (RMW_RET_OK != ret) {
-    return ret;
-  }
-  if (RMW_NODE_NAME_VALID != validation_result) {
-    const char * reason = rmw_node_name_validation_result_string(validation_result);
-    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("node_name argument is invalid: %s", reason);
-    return RMW_RET_INVALID_ARGUMENT;
+  // Topics are kept under the names they were created with, so no_mangle only means the name
+  // needn't follow ROS conventions
+  if (!no_mangle) {
+    int validation_result = RMW_TOPIC_VALID;
+    rmw_ret_t ret = rmw_validate_full_topic_name(topic_name, &validation_result, NULL);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+    if (RMW_TOPIC_VALID != validation_result) {
+      const char * reason = rmw_full_topic_name_validation_result_string(validation_result);
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("topic_name argument is invalid: %s", reason);
+      return RMW_RET_INVALID_ARGUMENT;
+    }
   }
   RCUTILS_CHECK_ALLOCATOR_WITH_MSG(
     allocator, "allocator argument is invalid", return RMW_RET_INVALID_ARGUMENT);
   if (RMW_RET_OK != rmw_topic_endpoint_info_array_check_zero(subscriptions_info)) {
     return RMW_RET_INVALID_ARGUMENT;
   }
-  (void)no_mangle;
 
-  RMW_SET_ERROR_MSG("rmw_get_subscriptions_info_by_topic hasn't been implemented yet");
-  return RMW_RET_UNSUPPORTED;
+  return hazcat_graph_get_endpoint_info(
+    topic_name, GRAPH_SUBSCRIPTION, allocator, subscriptions_info);
 }
 #ifdef __cplusplus
 }
@@ -13,9 +13,14 @@
 // limitations under the License.
 
 #ifdef __linux__
+#include <fcntl.h>
+#include <limits.h>
 #include <signal.h>
 #include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
 #endif
+#include <time.h>
 
 #include "rmw/allocators.h"
 #include "rmw/error_handling.h"
@@ -23,39 +28,440 @@
 
 #include "hazcat/types.h"
 
+#include "rmw_hazcat/hazcat_event.h"
+#include "rmw_hazcat/hazcat_guard_condition.h"
+#include "rmw_hazcat/hazcat_init_options.h"
+#include "rmw_hazcat/hazcat_service.h"
+#include "rmw_hazcat/hazcat_wait_set.h"
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
+
+#define MIN_TABLE_CAPACITY 16
+
+// Spinning only looks at queue indices and guard condition flags. Check epoll once every this
+// many passes too, for anything that has neither
+#define SPIN_EPOLL_INTERVAL 64
+
+#define NS_PER_MS 1000000
+#define NS_PER_SEC 1000000000
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SPIN_PAUSE() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define SPIN_PAUSE() __asm__ __volatile__ ("yield")
+#else
+#define SPIN_PAUSE()
+#endif
+
+// Bumped whenever an entity that might be registered with a wait set is destroyed
+static uint32_t invalidations = 0;
+
+void
+hazcat_wait_set_invalidate(void)
+{
+  __atomic_fetch_add(&invalidations, 1, __ATOMIC_RELEASE);
+}
+
+// Move every entry into a fresh table of the given capacity. If drop_stale is set, entries that
+// weren't asked for in the current rmw_wait call are removed from epoll and freed
+static rmw_ret_t
+rebuild_table(wait_set_info_t * info, size_t capacity, bool drop_stale)
+{
+  wait_entry_t ** table = rmw_allocate(capacity * sizeof(wait_entry_t *));
+  if (NULL == table) {
+    RMW_SET_ERROR_MSG("Unable to allocate memory for wait set table");
+    return RMW_RET_BAD_ALLOC;
+  }
+  memset(table, 0, capacity * sizeof(wait_entry_t *));
+
+  size_t count = 0;
+  for (size_t i = 0; i < info->capacity; i++) {
+    wait_entry_t * entry = info->table[i];
+    if (NULL == entry) {
+      continue;
+    }
+    if (drop_stale && entry->stamp != info->stamp) {
+      // Fd may already be closed, in which case epoll forgot about it on its own
+      #ifdef __linux__
+      if (-1 == epoll_ctl(info->ws.epollfd, EPOLL_CTL_DEL, entry->fd, NULL) &&
+        ENOENT != errno && EBADF != errno)
+      {
+        perror("epoll_ctl: ");
+      }
+      #endif
+      rmw_free(entry);
+      continue;
+    }
+    size_t j = (size_t)entry->fd & (capacity - 1);
+    while (NULL != table[j]) {
+      j = (j + 1) & (capacity - 1);
+    }
+    table[j] = entry;
+    count++;
+  }
+
+  rmw_free(info->table);
+  info->table = table;
+  info->capacity = capacity;
+  info->count = count;
+  return RMW_RET_OK;
+}
+
+static void
+free_entries(wait_set_info_t * info)
+{
+  for (size_t i = 0; i < info->capacity; i++) {
+    rmw_free(info->table[i]);
+    info->table[i] = NULL;
+  }
+  info->count = 0;
+}
+
+// Drop every registration by replacing the epoll instance, which is cheaper than removing them
+// one at a time
+static rmw_ret_t
+reset_epoll(wait_set_info_t * info)
+{
+  #ifdef __linux__
+  int epollfd = epoll_create1(EPOLL_CLOEXEC);
+  if (-1 == epollfd) {
+    RMW_SET_ERROR_MSG("Unable to create epoll instance for wait set");
+    perror("epoll_create1: ");
+    return RMW_RET_ERROR;
+  }
+  close(info->ws.epollfd);
+  info->ws.epollfd = epollfd;
+  #endif
+  free_entries(info);
+  info->timer_registered = false;
+  return RMW_RET_OK;
+}
+
+// Make sure there's room to number count positions
+static rmw_ret_t
+reserve_positions(wait_set_info_t * info, size_t count)
+{
+  if (count <= info->position_capacity) {
+    return RMW_RET_OK;
+  }
+  size_t capacity = (info->position_capacity > 0) ? 2 * info->position_capacity : 1;
+  while (capacity < count) {
+    capacity *= 2;
+  }
+  int * links = rmw_allocate(capacity * sizeof(int));
+  uint64_t * marks = rmw_allocate(capacity * sizeof(uint64_t));
+  pub_sub_data_t ** queues = rmw_allocate(capacity * sizeof(pub_sub_data_t *));
+  if (NULL == links || NULL == marks || NULL == queues) {
+    rmw_free(links);
+    rmw_free(marks);
+    rmw_free(queues);
+    RMW_SET_ERROR_MSG("Unable to allocate memory for wait set positions");
+    return RMW_RET_BAD_ALLOC;
+  }
+  memset(marks, 0, capacity * sizeof(uint64_t));
+  rmw_free(info->links);
+  rmw_free(info->marks);
+  rmw_free(info->queues);
+  info->links = links;
+  info->marks = marks;
+  info->queues = queues;
+  info->position_capacity = capacity;
+  return RMW_RET_OK;
+}
+
+// Make sure fd is registered, mark it as wanted by the current rmw_wait call, and add pos to the
+// positions using it. *seen counts the distinct fds marked so far in this call
+static rmw_ret_t
+watch_fd(
+  wait_set_info_t * info, int fd, const void * owner, wait_kind_t kind, uint32_t events, int pos,
+  size_t * seen, wait_entry_t ** out)
+{
+  size_t mask = info->capacity - 1;
+  size_t i = (size_t)fd & mask;
+  wait_entry_t * entry;
+  while (NULL != (entry = info->table[i])) {
+    if (entry->fd == fd) {
+      break;
+    }
+    i = (i + 1) & mask;
+  }
+
+  if (NULL == entry) {
+    // Not registered yet. Keep the table at most half full, so probes stay short
+    if (2 * (info->count + 1) > info->capacity) {
+      rmw_ret_t ret = rebuild_table(info, 2 * info->capacity, false);
+      if (RMW_RET_OK != ret) {
+        return ret;
+      }
+      return watch_fd(info, fd, owner, kind, events, pos, seen, out);
+    }
+    // Leave a slot for the timer
+    if (info->count + 2 > info->evlist_capacity) {
+      size_t evlist_capacity = 2 * info->evlist_capacity;
+      struct epoll_event * evlist = rmw_allocate(evlist_capacity * sizeof(struct epoll_event));
+      if (NULL == evlist) {
+        RMW_SET_ERROR_MSG("Unable to allocate memory for wait set event list");
+        return RMW_RET_BAD_ALLOC;
+      }
+      rmw_free(info->ws.evlist);
+      info->ws.evlist = evlist;
+      info->evlist_capacity = evlist_capacity;
+    }
+
+    entry = rmw_allocate(sizeof(wait_entry_t));
+    if (NULL == entry) {
+      RMW_SET_ERROR_MSG("Unable to allocate memory for wait set entry");
+      return RMW_RET_BAD_ALLOC;
+    }
+    entry->fd = fd;
+    entry->kind = kind;
+    entry->owner = owner;
+    entry->stamp = 0;
+    entry->ready_stamp = 0;
+
+    #ifdef __linux__
+    // Subscriptions' signals are drained after every wakeup, which mustn't block if another
+    // thread got to them first
+    if (WAIT_SUBSCRIPTION == kind) {
+      int flags = fcntl(fd, F_GETFL);
+      if (-1 == flags || -1 == fcntl(fd, F_SETFL, flags | O_NONBLOCK)) {
+        perror("fcntl: ");
+        rmw_free(entry);
+        return RMW_RET_ERROR;
+      }
+    }
+    struct epoll_event ev = {.events = events, .data.ptr = entry};
+    if (-1 == epoll_ctl(info->ws.epollfd, EPOLL_CTL_ADD, fd, &ev)) {
+      perror("epoll_ctl: ");
+      rmw_free(entry);
+      return RMW_RET_ERROR;
+    }
+    #else
+    // TODO(nightduck): Use poll instead
+    #endif
+    info->table[i] = entry;
+    info->count++;
+  } else if (entry->owner != owner || entry->kind != kind) {
+    // Fd number was reused by a new entity. The entry stays where epoll points, it just changes
+    // hands. Whatever the old owner had pending means nothing to the new one
+    #ifdef __linux__
+    struct epoll_event ev = {.events = events, .data.ptr = entry};
+    if (-1 == epoll_ctl(info->ws.epollfd, EPOLL_CTL_MOD, fd, &ev) &&
+      (ENOENT != errno || -1 == epoll_ctl(info->ws.epollfd, EPOLL_CTL_ADD, fd, &ev)))
+    {
+      perror("epoll_ctl: ");
+      return RMW_RET_ERROR;
+    }
+    #endif
+    entry->kind = kind;
+    entry->owner = owner;
+    entry->ready_stamp = 0;
+  }
+
+  if (entry->stamp != info->stamp) {
+    entry->stamp = info->stamp;
+    entry->first = -1;
+    (*seen)++;
+  }
+  info->links[pos] = entry->first;
+  entry->first = pos;
+  *out = entry;
+  return RMW_RET_OK;
+}
+
+static inline bool
+has_message(const pub_sub_data_t * sub)
+{
+  return sub->next_index != __atomic_load_n(&sub->mq->elem->index, __ATOMIC_ACQUIRE);
+}
+
+static inline uint64_t
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Poll the message queues and the guard conditions for up to budget_ns, marking any that are
+// ready. Returns the number of positions marked, or -1 on error. If epoll reports something first,
+// *ready is set to the number of events waiting in evlist
+static int
+spin(
+  wait_set_info_t * info, size_t num_queues, rmw_guard_conditions_t * guard_conditions,
+  size_t num_gcs, uint64_t budget_ns, int * ready)
+{
+  uint64_t start = now_ns();
+  int found = 0;
+  for (uint32_t pass = 1; ; pass++) {
+    for (size_t i = 0; i < num_queues; i++) {
+      if (has_message(info->queues[i])) {
+        info->marks[i] = info->stamp;
+        found++;
+      }
+    }
+    for (size_t i = 0; i < num_gcs; i++) {
+      guard_condition_info_t * gc = guard_conditions->guard_conditions[i];
+      if (__atomic_load_n(&gc->pending, __ATOMIC_ACQUIRE) && hazcat_guard_condition_take(gc) > 0) {
+        info->marks[num_queues + i] = info->stamp;
+        found++;
+      }
+    }
+    if (found > 0) {
+      return found;
+    }
+
+    #ifdef __linux__
+    if (0 == pass % SPIN_EPOLL_INTERVAL) {
+      *ready = epoll_wait(info->ws.epollfd, info->ws.evlist, info->ws.len, 0);
+      if (0 != *ready) {
+        return (*ready > 0) ? 0 : -1;
+      }
+    }
+    #endif
+
+    if (now_ns() - start >= budget_ns) {
+      return 0;
+    }
+    SPIN_PAUSE();
+  }
+}
+
+#ifdef __linux__
+// Arm the wait set's timer to fire once after timeout_ns, creating and registering it if needed
+static int
+arm_timer(wait_set_info_t * info, int64_t timeout_ns)
+{
+  if (-1 == info->timer.fd) {
+    info->timer.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (-1 == info->timer.fd) {
+      return -1;
+    }
+  }
+  if (!info->timer_registered) {
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = &info->timer};
+    if (-1 == epoll_ctl(info->ws.epollfd, EPOLL_CTL_ADD, info->timer.fd, &ev)) {
+      return -1;
+    }
+    info->timer_registered = true;
+  }
+  struct itimerspec its = {
+    .it_interval = {0, 0},
+    .it_value = {timeout_ns / NS_PER_SEC, timeout_ns % NS_PER_SEC}
+  };
+  if (-1 == timerfd_settime(info->timer.fd, 0, &its, NULL)) {
+    return -1;
+  }
+  info->timer_armed = true;
+  return 0;
+}
+
+// Stop the timer and forget any expiration that hasn't been read, so it can't wake a later call
+static int
+disarm_timer(wait_set_info_t * info)
+{
+  struct itimerspec its = {{0, 0}, {0, 0}};
+  if (-1 == timerfd_settime(info->timer.fd, 0, &its, NULL)) {
+    return -1;
+  }
+  info->timer_armed = false;
+  return 0;
+}
+
+// epoll_wait with a timeout in nanoseconds, -1 to wait forever. Returns what epoll_wait would
+static int
+wait_epoll(wait_set_info_t * info, int64_t timeout_ns)
+{
+  static bool has_pwait2 = true;
+  waitset_t * ws = &info->ws;
+  int maxevents = ws->len + (info->timer_registered ? 1 : 0);
+
+  if (info->timer_armed && -1 == disarm_timer(info)) {
+    return -1;
+  }
+  // Whole milliseconds only go to epoll_wait while they fit its int. Longer timeouts take the
+  // nanosecond paths below rather than overflowing, or being cut short by clamping
+  if (timeout_ns <= 0 || (0 == timeout_ns % NS_PER_MS && timeout_ns / NS_PER_MS <= INT_MAX)) {
+    int timeout_ms = (timeout_ns <= 0) ? (int)timeout_ns : (int)(timeout_ns / NS_PER_MS);
+    return epoll_wait(ws->epollfd, ws->evlist, maxevents, timeout_ms);
+  }
+
+  #ifdef SYS_epoll_pwait2
+  if (__atomic_load_n(&has_pwait2, __ATOMIC_RELAXED)) {
+    struct timespec ts = {timeout_ns / NS_PER_SEC, timeout_ns % NS_PER_SEC};
+    int ready = syscall(SYS_epoll_pwait2, ws->epollfd, ws->evlist, maxevents, &ts, NULL, 0);
+    if (-1 != ready || ENOSYS != errno) {
+      return ready;
+    }
+    __atomic_store_n(&has_pwait2, false, __ATOMIC_RELAXED);
+  }
+  #endif
+
+  if (-1 == arm_timer(info, timeout_ns)) {
+    return -1;
+  }
+  return epoll_wait(ws->epollfd, ws->evlist, ws->len + 1, -1);
+}
+#endif
+
 rmw_wait_set_t *
 rmw_create_wait_set(rmw_context_t * context, size_t max_conditions)
 {
   RCUTILS_CHECK_ARGUMENT_FOR_NULL(context, NULL);
 
-  waitset_t * ws = rmw_allocate(sizeof(waitset_t) + max_conditions * sizeof(struct epoll_event));
-  if (ws == NULL) {
+  wait_set_info_t * info = rmw_allocate(sizeof(wait_set_info_t));
+  if (info == NULL) {
     RMW_SET_ERROR_MSG("Unable to allocate memory for waitset implementation");
     return NULL;
   }
-  ws->evlist = (struct epoll_event *)(ws + 1);
-  ws->epollfd = epoll_create(max_conditions);
-  // ws->num_subs = 0;
-  // ws->num_gcs = 0;
-  // ws->num_cls = 0;
-  // ws->num_srv = 0;
-  // ws->num_evt = 0;
-  // ws->subscriptions = (rmw_subscription_t*)(ws+1);
-  // ws->guard_conditions = (rmw_guard_condition_t*)(ws+1);
-  // ws->clients = (rmw_client_t*)(ws+1);
-  // ws->services = (rmw_service_t*)(ws+1);
-  // ws->events = (rmw_events_t*)(ws+1);
+  waitset_t * ws = &info->ws;
+
+  // max_conditions is only a hint, rcl doesn't recreate the wait set when it's resized
+  size_t capacity = MIN_TABLE_CAPACITY;
+  while (capacity < 2 * max_conditions) {
+    capacity *= 2;
+  }
+  info->stamp = 0;
+  info->spin_ns = (NULL != context->options.impl) ?
+    ((init_options_impl_t *)context->options.impl)->wait_spin_ns : 0;
+  info->epoch = __atomic_load_n(&invalidations, __ATOMIC_ACQUIRE);
+  info->count = 0;
+  info->capacity = capacity;
+  info->evlist_capacity = capacity / 2;
+  info->position_capacity = 0;
+  info->links = NULL;
+  info->marks = NULL;
+  info->queues = NULL;
+  info->timer.fd = -1;
+  info->timer.kind = WAIT_TIMER;
+  info->timer.owner = NULL;
+  info->timer_registered = false;
+  info->timer_armed = false;
+  info->table = rmw_allocate(capacity * sizeof(wait_entry_t *));
+  ws->evlist = rmw_allocate(info->evlist_capacity * sizeof(struct epoll_event));
+  if (NULL == info->table || NULL == ws->evlist ||
+    RMW_RET_OK != reserve_positions(info, capacity / 2))
+  {
+    RMW_SET_ERROR_MSG("Unable to allocate memory for waitset implementation");
+    return NULL;
+  }
+  memset(info->table, 0, capacity * sizeof(wait_entry_t *));
+  ws->len = 0;
+  ws->epollfd = epoll_create1(EPOLL_CLOEXEC);
+  if (-1 == ws->epollfd) {
+    RMW_SET_ERROR_MSG("Unable to create epoll instance for wait set");
+    return NULL;
+  }
 
   rmw_wait_set_t * rmw_ws = rmw_wait_set_allocate();
   if (rmw_ws == NULL) {
     RMW_SET_ERROR_MSG("Unable to allocate memory for waitset implementation");
     return NULL;
   }
-  rmw_ws->data = (void *)ws;
+  rmw_ws->data = (void *)info;
   rmw_ws->implementation_identifier = rmw_get_implementation_identifier();
 
   return rmw_ws;
@@ -69,15 +475,36 @@ rmw_destroy_wait_set(rmw_wait_set_t * wait_set)
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
 
-  rmw_ret_t ret;
-  waitset_t * ws = wait_set->data;
-  close(ws->epollfd);
-  rmw_free(ws);
+  wait_set_info_t * info = wait_set->data;
+  close(info->ws.epollfd);
+  if (-1 != info->timer.fd) {
+    close(info->timer.fd);
+  }
+  free_entries(info);
+  rmw_free(info->ws.evlist);
+  rmw_free(info->table);
+  rmw_free(info->links);
+  rmw_free(info->marks);
+  rmw_free(info->queues);
+  rmw_free(info);
   rmw_free(wait_set);
 
   return RMW_RET_OK;
 }
 
+rmw_ret_t
+rmw_hazcat_wait_set_set_spin(rmw_wait_set_t * wait_set, uint64_t spin_ns)
+{
+  RCUTILS_CHECK_ARGUMENT_FOR_NULL(wait_set, RMW_RET_INVALID_ARGUMENT);
+  if (wait_set->implementation_identifier != rmw_get_implementation_identifier()) {
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
+  }
+
+  ((wait_set_info_t *)wait_set->data)->spin_ns = spin_ns;
+
+  return RMW_RET_OK;
+}
+
 void
 set_all_null(
   rmw_subscriptions_t * subscriptions,
@@ -113,45 +540,31 @@ set_all_null(
   }
 }
 
-#ifdef __linux__
-int
-clear_epoll(
-  rmw_subscriptions_t * subscriptions,
-  rmw_guard_conditions_t * guard_conditions,
-  rmw_services_t * services,
-  rmw_clients_t * clients,
-  rmw_events_t * events,
-  int epollfd)
+// Register the message queue of a subscription, or of a service's or client's internal one, for
+// position pos. Queues that were ready last time are checked again right away
+static rmw_ret_t
+watch_queue(wait_set_info_t * info, pub_sub_data_t * sub, int pos, size_t * seen, size_t * found)
 {
-  if (NULL != subscriptions) {
-    for (int i = 0; i < subscriptions->subscriber_count; i++) {
-      RCUTILS_CHECK_ARGUMENT_FOR_NULL(subscriptions->subscribers[0], RMW_RET_ERROR);
-      pub_sub_data_t * sub = (pub_sub_data_t *)subscriptions->subscribers[0];
-      struct epoll_event ev = {.events = EPOLLHUP, .data = sub};
-      if (epoll_ctl(epollfd, EPOLL_CTL_DEL, sub->mq->signalfd, &ev) == -1 && errno != ENOENT) {
-        RMW_SET_ERROR_MSG("Unable to remove subscription from epoll");
-        perror("epoll_ctl: ");
-        return -1;
-      }
-    }
+  wait_entry_t * entry;
+  rmw_ret_t ret = watch_fd(
+    info, sub->mq->signalfd, sub->mq, WAIT_SUBSCRIPTION, EPOLLIN, pos, seen, &entry);
+  if (RMW_RET_OK != ret) {
+    return ret;
   }
+  info->queues[pos] = sub;
 
-  if (NULL != guard_conditions) {
-    for (int i = 0; i < guard_conditions->guard_condition_count; i++) {
-      RCUTILS_CHECK_ARGUMENT_FOR_NULL(guard_conditions->guard_conditions[0], RMW_RET_ERROR);
-      guard_condition_t * gc = (guard_condition_t *)guard_conditions->guard_conditions[i];
-      if (epoll_ctl(epollfd, EPOLL_CTL_DEL, gc->pfd[1], &gc->ev) == -1 && errno != ENOENT) {
-        RMW_SET_ERROR_MSG("Unable to remove guard condition from epoll");
-        perror("epoll_ctl: ");
-        return -1;
-      }
-    }
+  // The signal for a topic that was ready last time has already been consumed, but there may be
+  // more than one message waiting. Only those topics need to be checked before blocking
+  if (entry->ready_stamp + 1 >= info->stamp && has_message(sub)) {
+    info->marks[pos] = info->stamp;
+    entry->ready_stamp = info->stamp;
+    (*found)++;
   }
+  return RMW_RET_OK;
 }
-#endif
 
-// NOTE: For performance reasons, it is assumed that each call to rmw_wait within a process will
-// contain the same list of entities. They are placed within a epoll instance and not removed
+// NOTE: Entities stay registered with the wait set's epoll instance between calls. Each call only
+// registers what's new since the last one, and unregisters what's been left out of it
 rmw_ret_t
 rmw_wait(
   rmw_subscriptions_t * subscriptions,
@@ -172,125 +585,267 @@ rmw_wait(
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
   }
 
-  waitset_t * ws = (waitset_t *)wait_set->data;
-  ws->len = 0;
+  wait_set_info_t * info = (wait_set_info_t *)wait_set->data;
+  waitset_t * ws = &info->ws;
+  rmw_ret_t ret;
+
+  size_t num_subs = (NULL != subscriptions) ? subscriptions->subscriber_count : 0;
+  size_t num_srvs = (NULL != services) ? services->service_count : 0;
+  size_t num_clients = (NULL != clients) ? clients->client_count : 0;
+  size_t num_gcs = (NULL != guard_conditions) ? guard_conditions->guard_condition_count : 0;
+  size_t num_events = (NULL != events) ? events->event_count : 0;
+  size_t num_queues = num_subs + num_srvs + num_clients;
+  size_t first_event = num_queues + num_gcs;
+  if (RMW_RET_OK != (ret = reserve_positions(info, first_event + num_events))) {
+    return ret;
+  }
+
+  // Something was destroyed since the last call, and its fd number may have been reused. Start
+  // over rather than trusting any registration
+  uint32_t epoch = __atomic_load_n(&invalidations, __ATOMIC_ACQUIRE);
+  if (epoch != info->epoch) {
+    if (RMW_RET_OK != (ret = reset_epoll(info))) {
+      return ret;
+    }
+    info->epoch = epoch;
+  }
+  uint64_t stamp = ++info->stamp;
+  size_t seen = 0;
+  size_t found = 0;
 
   // NOTE: Each sub stores a signalfd corresponding to the file of its topic's message queue. Each
   // guard condition is just an unamed pipe. Publishing to a topic will send a signal on the message
   // queue file, to each subscriber's signalfd. These signalfds (and the guard condition pipes) are
   // added to epoll/poll, which waits on available input
 
-  // Each message queue associated with a topic has an rmw_guard_condition. We collect all of them
-  // from each subscription's topic, add them all to a poll/epoll. Similar approach for services
-  // and clients. guard_conditions are just added directly. No strategy for events. Waiting on the
-  // poll/epoll will reveal which topics or guards are ready
+  // Services and clients are waited on through the message queues of their internal
+  // subscriptions, requests for a service and responses for a client. They're registered just like
+  // subscriptions, so one epoll instance covers topic and service traffic alike. guard_conditions
+  // are just added directly. Waiting on the poll/epoll will reveal which topics or guards are
+  // ready. Deadline and liveliness events wait on their timers, see hazcat_event.h
 
-  if (NULL != subscriptions) {
-    for (int i = 0; i < subscriptions->subscriber_count; i++) {
-      #ifdef __linux__
-      RCUTILS_CHECK_ARGUMENT_FOR_NULL(subscriptions->subscribers[i], RMW_RET_ERROR);
-      pub_sub_data_t * sub = (pub_sub_data_t *)subscriptions->subscribers[i];
-      struct epoll_event ev = {.events = EPOLLIN, .data = sub->mq->signalfd};
-      if (-1 == epoll_ctl(ws->epollfd, EPOLL_CTL_ADD, sub->mq->signalfd, &ev) && EEXIST != errno) {
-        perror("epoll_ctl: ");
-        RMW_SET_ERROR_MSG("Unable to wait on subscription");
-        return RMW_RET_ERROR;
-      }
-      #else
-      // TODO(nightduck): Use poll instead
-      #endif
-      ws->len++;
+  for (size_t i = 0; i < num_subs; i++) {
+    RCUTILS_CHECK_ARGUMENT_FOR_NULL(subscriptions->subscribers[i], RMW_RET_ERROR);
+    ret = watch_queue(info, subscriptions->subscribers[i], i, &seen, &found);
+    if (RMW_RET_OK != ret) {
+      RMW_SET_ERROR_MSG("Unable to wait on subscription");
+      return ret;
     }
   }
 
-  if (NULL != guard_conditions) {
-    for (int i = 0; i < guard_conditions->guard_condition_count; i++) {
-      #ifdef __linux__
-      RCUTILS_CHECK_ARGUMENT_FOR_NULL(guard_conditions->guard_conditions[i], RMW_RET_ERROR);
-      guard_condition_t * gc = (guard_condition_t *)guard_conditions->guard_conditions[i];
-      gc->ev.data.ptr = guard_conditions->guard_conditions[i];
-      if (-1 == epoll_ctl(ws->epollfd, EPOLL_CTL_ADD, gc->pfd[1], &gc->ev) && EEXIST != errno) {
-        perror("epoll_ctl: ");
-        RMW_SET_ERROR_MSG("Unable to wait on guard condition");
-        return RMW_RET_ERROR;
+  for (size_t i = 0; i < num_srvs; i++) {
+    RCUTILS_CHECK_ARGUMENT_FOR_NULL(services->services[i], RMW_RET_ERROR);
+    service_info_t * srv = services->services[i];
+    ret = watch_queue(info, srv->requests->data, num_subs + i, &seen, &found);
+    if (RMW_RET_OK != ret) {
+      RMW_SET_ERROR_MSG("Unable to wait on service");
+      return ret;
+    }
+  }
+
+  for (size_t i = 0; i < num_clients; i++) {
+    RCUTILS_CHECK_ARGUMENT_FOR_NULL(clients->clients[i], RMW_RET_ERROR);
+    client_info_t * client = clients->clients[i];
+    ret = watch_queue(info, client->responses->data, num_subs + num_srvs + i, &seen, &found);
+    if (RMW_RET_OK != ret) {
+      RMW_SET_ERROR_MSG("Unable to wait on client");
+      return ret;
+    }
+  }
+
+  for (size_t i = 0; i < num_gcs; i++) {
+    RCUTILS_CHECK_ARGUMENT_FOR_NULL(guard_conditions->guard_conditions[i], RMW_RET_ERROR);
+    guard_condition_info_t * gc = guard_conditions->guard_conditions[i];
+    wait_entry_t * entry;
+    ret = watch_fd(info, gc->fd, gc, WAIT_GUARD_CONDITION, EPOLLIN, num_queues + i, &seen, &entry);
+    if (RMW_RET_OK != ret) {
+      RMW_SET_ERROR_MSG("Unable to wait on guard condition");
+      return ret;
+    }
+  }
+
+  for (size_t i = 0; i < num_events; i++) {
+    RCUTILS_CHECK_ARGUMENT_FOR_NULL(events->events[i], RMW_RET_ERROR);
+    event_timer_t * timer = hazcat_event_timer(events->events[i]);
+    int fd = (NULL != timer) ? __atomic_load_n(&timer->fd, __ATOMIC_ACQUIRE) : -1;
+    if (-1 != fd) {
+      wait_entry_t * entry;
+      ret = watch_fd(info, fd, timer, WAIT_EVENT, EPOLLIN, first_event + i, &seen, &entry);
+      if (RMW_RET_OK != ret) {
+        RMW_SET_ERROR_MSG("Unable to wait on event");
+        return ret;
       }
-      #else
-      // TODO(nightduck): Use poll instead
-      #endif
-      ws->len++;
+    }
+    if (hazcat_event_is_ready(events->events[i])) {
+      info->marks[first_event + i] = stamp;
+      found++;
     }
   }
 
-  if (ws->len == 0) {
+  // Some registered fds weren't asked for this time, unregister them
+  if (seen < info->count) {
+    if (RMW_RET_OK != (ret = rebuild_table(info, info->capacity, true))) {
+      return ret;
+    }
+  }
+  ws->len = info->count;
+
+  if (ws->len == 0 && found == 0) {
     // Nothing to wait on, just return
     return RMW_RET_TIMEOUT;
   }
 
-  // Calculate timeout and wait
-  int timeout;
-  if (wait_timeout == NULL) {
+  // Calculate timeout in nanoseconds, -1 to wait forever. If something is already known to be
+  // ready, just collect whatever else is
+  int64_t timeout;
+  if (found > 0) {
+    timeout = 0;
+  } else if (wait_timeout == NULL || wait_timeout->sec >= INT64_MAX / NS_PER_SEC) {
     timeout = -1;
   } else {
-    timeout = wait_timeout->sec * 1000 + wait_timeout->nsec / 1000000;
+    timeout = (int64_t)wait_timeout->sec * NS_PER_SEC + (int64_t)wait_timeout->nsec;
   }
-  #ifdef __linux__
-  int ready = epoll_wait(ws->epollfd, ws->evlist, ws->len, timeout);
-  if (ready == -1) {
-    RMW_SET_ERROR_MSG("rmw_wait error in epoll_wait");
-    perror("epoll_wait: ");
-    return RMW_RET_ERROR;
-  } else if (ready == 0) {
-    // Uncomment if you can't make guarantees about persistence of executable-to-executor assignment
-    clear_epoll(subscriptions, guard_conditions, services, clients, events, ws->epollfd);
 
-    // Timed out, set everything to null
-    set_all_null(subscriptions, guard_conditions, services, clients, events);
-    return RMW_RET_TIMEOUT;
+  // When the timeout runs out, in case epoll has to be waited on more than once
+  uint64_t deadline = (timeout > 0) ? now_ns() + (uint64_t)timeout : 0;
+
+  // Spin first if asked to, taking the time spent out of the timeout
+  int ready = 0;
+  if (0 != timeout && info->spin_ns > 0) {
+    uint64_t budget = info->spin_ns;
+    if (timeout > 0 && (uint64_t)timeout < budget) {
+      budget = (uint64_t)timeout;
+    }
+    uint64_t start = now_ns();
+    int spun = spin(info, num_queues, guard_conditions, num_gcs, budget, &ready);
+    if (spun < 0) {
+      RMW_SET_ERROR_MSG("rmw_wait error in epoll_wait");
+      perror("epoll_wait: ");
+      return RMW_RET_ERROR;
+    }
+    found += spun;
+    if (found > 0) {
+      timeout = 0;
+    } else if (timeout > 0) {
+      uint64_t spent = now_ns() - start;
+      timeout = (spent < (uint64_t)timeout) ? timeout - (int64_t)spent : 0;
+    }
   }
-  // for(int i = 0; i < ready; i++) {
-  //   if((ws->evlist[i].events & EPOLLERR) ||
-  //     (ws->evlist[i].events & EPOLLHUP) ||
-  //     (!(ws->evlist[i].events & EPOLLIN)))
-  //   {
-  //     RMW_SET_ERROR_MSG("Error reading triggered guard condition");
-  //     continue;
-  //   }
-  //   ws->evlist[i].data.fd;
-  #else
-  // TODO(nightduck): Use poll instead
-  #endif
 
-  // See if this can clear signal fifos
   char buffer[4096];
-  for (int i = 0; i < ready; i++) {
-    read(ws->evlist[i].data.fd, buffer, ws->evlist[i].events);
+  bool timed_out = false;
+  for (;;) {
+    #ifdef __linux__
+    if (0 == ready && ws->len > 0) {
+      ready = wait_epoll(info, timeout);
+    }
+    if (ready == -1) {
+      RMW_SET_ERROR_MSG("rmw_wait error in epoll_wait");
+      perror("epoll_wait: ");
+      return RMW_RET_ERROR;
+    } else if (ready == 0 && found == 0) {
+      // Timed out, set everything to null
+      set_all_null(subscriptions, guard_conditions, services, clients, events);
+      return RMW_RET_TIMEOUT;
+    }
+    #else
+    // TODO(nightduck): Use poll instead
+    #endif
+
+    // Only the entries epoll reported need a look. Each one leads to every position sharing its fd
+    for (int i = 0; i < ready; i++) {
+      wait_entry_t * entry = (wait_entry_t *)ws->evlist[i].data.ptr;
+      switch (entry->kind) {
+        case WAIT_SUBSCRIPTION:
+          // Consume the signals first, so a message published after the check below still leaves
+          // one behind for the next call
+          while (read(entry->fd, buffer, sizeof(buffer)) == sizeof(buffer)) {
+          }
+          for (int pos = entry->first; pos != -1; pos = info->links[pos]) {
+            if (info->marks[pos] != stamp && has_message(info->queues[pos])) {
+              info->marks[pos] = stamp;
+              entry->ready_stamp = stamp;
+              found++;
+            }
+          }
+          break;
+        case WAIT_GUARD_CONDITION:
+          if (hazcat_guard_condition_take((guard_condition_info_t *)entry->owner) > 0) {
+            for (int pos = entry->first; pos != -1; pos = info->links[pos]) {
+              if (info->marks[pos] != stamp) {
+                info->marks[pos] = stamp;
+                found++;
+              }
+            }
+          }
+          break;
+        case WAIT_EVENT:
+          hazcat_event_check((event_timer_t *)entry->owner);
+          for (int pos = entry->first; pos != -1; pos = info->links[pos]) {
+            if (info->marks[pos] != stamp &&
+              hazcat_event_is_ready(events->events[pos - first_event]))
+            {
+              info->marks[pos] = stamp;
+              found++;
+            }
+          }
+          break;
+        case WAIT_TIMER:
+          // Timeout expired. Anything else reported alongside it still counts
+          read(entry->fd, buffer, sizeof(uint64_t));
+          info->timer_armed = false;
+          timed_out = true;
+          break;
+      }
+    }
+
+    if (found > 0 || timed_out) {
+      break;
+    }
+    // An event timer fired without its status changing, or signals were left behind by messages
+    // already taken. Go back to waiting for whatever time is left
+    if (timeout > 0) {
+      uint64_t now = now_ns();
+      timeout = (now < deadline) ? (int64_t)(deadline - now) : 0;
+    }
+    if (0 == timeout) {
+      timed_out = true;
+      break;
+    }
+    ready = 0;
   }
 
-  // We don't interpret the event list from polling, we only use it to signal SOMETHING is ready,
-  // manually check everything to see if it is
+  if (0 == found && timed_out) {
+    set_all_null(subscriptions, guard_conditions, services, clients, events);
+    return RMW_RET_TIMEOUT;
+  }
 
-  if (NULL != subscriptions) {
-    for (int i = 0; i < subscriptions->subscriber_count; i++) {
-      // if next index and my index equal, set pointer to null, because no message available
-      pub_sub_data_t * sub = (pub_sub_data_t *)subscriptions->subscribers[i];
-      message_queue_t * mq = sub->mq->elem;
-      if (sub->next_index == mq->index) {
-        subscriptions->subscribers[i] = NULL;
-      }
+  // Whatever wasn't marked ready above is set to NULL
+  for (size_t i = 0; i < num_subs; i++) {
+    if (info->marks[i] != stamp) {
+      subscriptions->subscribers[i] = NULL;
     }
   }
-  if (NULL != guard_conditions) {
-    for (int i = 0; i < guard_conditions->guard_condition_count; i++) {
-      // attempt to read from pipe, if unsuccessful, set to null
-      guard_condition_t * gc = guard_conditions->guard_conditions[i];
-      if (guard_condition_trigger_count(gc) <= 0) {
-        guard_conditions->guard_conditions[i] = NULL;
-      }
+  for (size_t i = 0; i < num_srvs; i++) {
+    if (info->marks[num_subs + i] != stamp) {
+      services->services[i] = NULL;
+    }
+  }
+  for (size_t i = 0; i < num_clients; i++) {
+    if (info->marks[num_subs + num_srvs + i] != stamp) {
+      clients->clients[i] = NULL;
+    }
+  }
+  for (size_t i = 0; i < num_gcs; i++) {
+    if (info->marks[num_queues + i] != stamp) {
+      guard_conditions->guard_conditions[i] = NULL;
+    }
+  }
+  for (size_t i = 0; i < num_events; i++) {
+    if (info->marks[first_event + i] != stamp) {
+      events->events[i] = NULL;
     }
   }
-
-  // Services, clients, and events not supported
-  set_all_null(NULL, NULL, services, clients, events);
 
   return RMW_RET_OK;
 }
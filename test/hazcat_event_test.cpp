@@ -0,0 +1,243 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "osrf_testing_tools_cpp/scope_exit.hpp"
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/event.h"
+#include "rmw/rmw.h"
+
+#include "test_msgs/msg/basic_types.h"
+
+// Deadlines and leases are kept short so the tests run quickly, and waits long enough that a
+// loaded machine doesn't time them out
+static const rmw_time_t short_period = {0, 50000000};
+static const rmw_time_t wait_timeout = {1, 0};
+
+class TestEvent : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rmw_init_options_t options = rmw_get_zero_initialized_init_options();
+    rmw_ret_t ret = rmw_init_options_init(&options, rcutils_get_default_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+    {
+      rmw_ret_t ret = rmw_init_options_fini(&options);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    });
+    options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", options.enclave);
+    context = rmw_get_zero_initialized_context();
+    ret = rmw_init(&options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    node = rmw_create_node(&context, "test_event", "/", 0, false);
+    ASSERT_NE(nullptr, node) << rcutils_get_error_string().str;
+    wait_set = rmw_create_wait_set(&context, 1);
+    ASSERT_NE(nullptr, wait_set) << rcutils_get_error_string().str;
+    ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&msg));
+  }
+
+  void TearDown() override
+  {
+    test_msgs__msg__BasicTypes__fini(&msg);
+    rmw_ret_t ret = rmw_destroy_wait_set(wait_set);
+    EXPECT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    ret = rmw_destroy_node(node);
+    EXPECT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    ret = rmw_shutdown(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    ret = rmw_context_fini(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+  }
+
+  // Whether rmw_wait reports event ready before wait_timeout runs out
+  bool wait_for(rmw_event_t * event)
+  {
+    void * handles[] = {event};
+    rmw_events_t events = {1, handles};
+    rmw_ret_t ret = rmw_wait(nullptr, nullptr, nullptr, nullptr, &events, wait_set, &wait_timeout);
+    EXPECT_TRUE(RMW_RET_OK == ret || RMW_RET_TIMEOUT == ret) << rcutils_get_error_string().str;
+    return RMW_RET_OK == ret && nullptr != handles[0];
+  }
+
+  rmw_context_t context;
+  rmw_node_t * node;
+  rmw_wait_set_t * wait_set;
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+  rmw_publisher_options_t pub_opts = rmw_get_default_publisher_options();
+  rmw_subscription_options_t sub_opts = rmw_get_default_subscription_options();
+  test_msgs__msg__BasicTypes msg;
+};
+
+TEST_F(TestEvent, offered_deadline_missed) {
+  rmw_qos_profile_t qos = rmw_qos_profile_default;
+  qos.deadline = short_period;
+  rmw_publisher_t * pub = rmw_create_publisher(node, type_support, "/deadline", &qos, &pub_opts);
+  ASSERT_NE(nullptr, pub) << rcutils_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, pub));
+  });
+  rmw_event_t event = rmw_get_zero_initialized_event();
+  ASSERT_EQ(RMW_RET_OK, rmw_publisher_event_init(&event, pub, RMW_EVENT_OFFERED_DEADLINE_MISSED)) <<
+    rcutils_get_error_string().str;
+
+  // Deadlines only start with the first message
+  rmw_offered_deadline_missed_status_t status;
+  bool taken = false;
+  ASSERT_EQ(RMW_RET_OK, rmw_take_event(&event, &status, &taken));
+  ASSERT_TRUE(taken);
+  EXPECT_EQ(0, status.total_count);
+  EXPECT_EQ(0, status.total_count_change);
+
+  ASSERT_EQ(RMW_RET_OK, rmw_publish(pub, &msg, nullptr));
+  ASSERT_TRUE(wait_for(&event));
+  ASSERT_EQ(RMW_RET_OK, rmw_take_event(&event, &status, &taken));
+  ASSERT_TRUE(taken);
+  EXPECT_GE(status.total_count, 1);
+  EXPECT_EQ(status.total_count, status.total_count_change);
+
+  // Missing more deadlines adds to the count
+  const int32_t missed = status.total_count;
+  ASSERT_TRUE(wait_for(&event));
+  ASSERT_EQ(RMW_RET_OK, rmw_take_event(&event, &status, &taken));
+  EXPECT_GT(status.total_count, missed);
+  EXPECT_EQ(status.total_count - missed, status.total_count_change);
+}
+
+TEST_F(TestEvent, requested_deadline_missed) {
+  rmw_qos_profile_t qos = rmw_qos_profile_default;
+  qos.deadline = short_period;
+  rmw_publisher_t * pub = rmw_create_publisher(node, type_support, "/deadline", &qos, &pub_opts);
+  ASSERT_NE(nullptr, pub) << rcutils_get_error_string().str;
+  rmw_subscription_t * sub =
+    rmw_create_subscription(node, type_support, "/deadline", &qos, &sub_opts);
+  ASSERT_NE(nullptr, sub) << rcutils_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub));
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, pub));
+  });
+  rmw_event_t event = rmw_get_zero_initialized_event();
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_subscription_event_init(&event, sub, RMW_EVENT_REQUESTED_DEADLINE_MISSED)) <<
+    rcutils_get_error_string().str;
+
+  ASSERT_EQ(RMW_RET_OK, rmw_publish(pub, &msg, nullptr));
+  bool taken = false;
+  ASSERT_EQ(RMW_RET_OK, rmw_take(sub, &msg, &taken, nullptr));
+  ASSERT_TRUE(taken);
+
+  ASSERT_TRUE(wait_for(&event));
+  rmw_requested_deadline_missed_status_t status;
+  ASSERT_EQ(RMW_RET_OK, rmw_take_event(&event, &status, &taken));
+  ASSERT_TRUE(taken);
+  EXPECT_GE(status.total_count, 1);
+  EXPECT_EQ(status.total_count, status.total_count_change);
+
+  // Taking it again reports no change
+  ASSERT_EQ(RMW_RET_OK, rmw_take_event(&event, &status, &taken));
+  EXPECT_EQ(0, status.total_count_change);
+}
+
+TEST_F(TestEvent, liveliness_lost) {
+  rmw_qos_profile_t qos = rmw_qos_profile_default;
+  qos.liveliness = RMW_QOS_POLICY_LIVELINESS_MANUAL_BY_TOPIC;
+  qos.liveliness_lease_duration = short_period;
+  rmw_publisher_t * pub = rmw_create_publisher(node, type_support, "/lost_lease", &qos, &pub_opts);
+  ASSERT_NE(nullptr, pub) << rcutils_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, pub));
+  });
+  rmw_event_t event = rmw_get_zero_initialized_event();
+  ASSERT_EQ(RMW_RET_OK, rmw_publisher_event_init(&event, pub, RMW_EVENT_LIVELINESS_LOST)) <<
+    rcutils_get_error_string().str;
+
+  // Publishers start out alive, and lose it once their first lease runs out
+  ASSERT_TRUE(wait_for(&event));
+  rmw_liveliness_lost_status_t status;
+  bool taken = false;
+  ASSERT_EQ(RMW_RET_OK, rmw_take_event(&event, &status, &taken));
+  ASSERT_TRUE(taken);
+  EXPECT_EQ(1, status.total_count);
+  EXPECT_EQ(1, status.total_count_change);
+
+  // Lost liveliness is only counted again after it's been asserted
+  ASSERT_FALSE(wait_for(&event));
+  ASSERT_EQ(RMW_RET_OK, rmw_publisher_assert_liveliness(pub));
+  ASSERT_TRUE(wait_for(&event));
+  ASSERT_EQ(RMW_RET_OK, rmw_take_event(&event, &status, &taken));
+  EXPECT_EQ(2, status.total_count);
+  EXPECT_EQ(1, status.total_count_change);
+}
+
+TEST_F(TestEvent, liveliness_changed) {
+  rmw_qos_profile_t qos = rmw_qos_profile_default;
+  rmw_subscription_t * sub =
+    rmw_create_subscription(node, type_support, "/changed", &qos, &sub_opts);
+  ASSERT_NE(nullptr, sub) << rcutils_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub));
+  });
+  rmw_event_t event = rmw_get_zero_initialized_event();
+  ASSERT_EQ(RMW_RET_OK, rmw_subscription_event_init(&event, sub, RMW_EVENT_LIVELINESS_CHANGED)) <<
+    rcutils_get_error_string().str;
+
+  // A publisher appearing is seen through the graph. Its lease is longer than the others, so it's
+  // still alive when the event is taken
+  qos.liveliness = RMW_QOS_POLICY_LIVELINESS_MANUAL_BY_TOPIC;
+  qos.liveliness_lease_duration = {0, 200000000};
+  rmw_publisher_t * pub = rmw_create_publisher(node, type_support, "/changed", &qos, &pub_opts);
+  ASSERT_NE(nullptr, pub) << rcutils_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, pub));
+  });
+  ASSERT_TRUE(wait_for(&event));
+  rmw_liveliness_changed_status_t status;
+  bool taken = false;
+  ASSERT_EQ(RMW_RET_OK, rmw_take_event(&event, &status, &taken));
+  ASSERT_TRUE(taken);
+  EXPECT_EQ(1, status.alive_count);
+  EXPECT_EQ(1, status.alive_count_change);
+  EXPECT_EQ(0, status.not_alive_count);
+  EXPECT_EQ(0, status.not_alive_count_change);
+
+  // Its lease running out without an assertion
+  ASSERT_TRUE(wait_for(&event));
+  ASSERT_EQ(RMW_RET_OK, rmw_take_event(&event, &status, &taken));
+  EXPECT_EQ(0, status.alive_count);
+  EXPECT_EQ(-1, status.alive_count_change);
+  EXPECT_EQ(1, status.not_alive_count);
+  EXPECT_EQ(1, status.not_alive_count_change);
+
+  // And publishing bringing it back to life
+  ASSERT_EQ(RMW_RET_OK, rmw_publish(pub, &msg, nullptr));
+  ASSERT_TRUE(wait_for(&event));
+  ASSERT_EQ(RMW_RET_OK, rmw_take_event(&event, &status, &taken));
+  EXPECT_EQ(1, status.alive_count);
+  EXPECT_EQ(1, status.alive_count_change);
+  EXPECT_EQ(0, status.not_alive_count);
+  EXPECT_EQ(-1, status.not_alive_count_change);
+}
@@ -33,7 +33,7 @@
 #include "rmw/error_handling.h"
 #include "rmw/rmw.h"
 
-#include "hazcat/types.h"
+#include "rmw_hazcat/hazcat_guard_condition.h"
 
 using std::atomic;
 using std::atomic_int;
@@ -73,8 +73,8 @@ protected:
 TEST_F(TestGuardCondition, signal_test) {
   rmw_guard_condition_t * gc1 = rmw_create_guard_condition(&context);
   rmw_guard_condition_t * gc2 = rmw_create_guard_condition(&context);
-  guard_condition_t * gc1_impl = reinterpret_cast<guard_condition_t *>(gc1->data);
-  guard_condition_t * gc2_impl = reinterpret_cast<guard_condition_t *>(gc2->data);
+  guard_condition_info_t * gc1_impl = reinterpret_cast<guard_condition_info_t *>(gc1->data);
+  guard_condition_info_t * gc2_impl = reinterpret_cast<guard_condition_info_t *>(gc2->data);
 
   bool check = false;
 
@@ -85,12 +85,12 @@ TEST_F(TestGuardCondition, signal_test) {
   std::thread t([&]() {
       // Wait on gc, other thread should set check true and then trigger guard
       int epollfd = epoll_create1(0);
-      struct epoll_event ev;
+      struct epoll_event ev = {EPOLLIN, {0}};
       if (epollfd == -1) {
         perror("epoll_create1");
         exit(EXIT_FAILURE);
       }
-      ASSERT_NE(epoll_ctl(epollfd, EPOLL_CTL_ADD, gc1_impl->pfd[0], &gc1_impl->ev), -1);
+      ASSERT_NE(epoll_ctl(epollfd, EPOLL_CTL_ADD, gc1_impl->fd, &ev), -1);
       ASSERT_NE(epoll_wait(epollfd, &ev, 1, 10), -1);
       close(epollfd);
 
@@ -103,10 +103,10 @@ TEST_F(TestGuardCondition, signal_test) {
     });
 
   // Wait on gc, other thread should set check to false and trigger guard
-  struct epoll_event ev;
+  struct epoll_event ev = {EPOLLIN, {0}};
   int epollfd = epoll_create1(0);
   ASSERT_NE(epollfd, -1);
-  ASSERT_NE(epoll_ctl(epollfd, EPOLL_CTL_ADD, gc2_impl->pfd[0], &gc2_impl->ev), -1);
+  ASSERT_NE(epoll_ctl(epollfd, EPOLL_CTL_ADD, gc2_impl->fd, &ev), -1);
   ASSERT_NE(epoll_wait(epollfd, &ev, 1, 10), -1);
   close(epollfd);
 
@@ -116,3 +116,19 @@ TEST_F(TestGuardCondition, signal_test) {
   EXPECT_EQ(RMW_RET_OK, rmw_destroy_guard_condition(gc2));
   t.join();
 }
+
+TEST_F(TestGuardCondition, trigger_count) {
+  rmw_guard_condition_t * gc = rmw_create_guard_condition(&context);
+  ASSERT_NE(nullptr, gc) << rcutils_get_error_string().str;
+  guard_condition_info_t * gc_impl = reinterpret_cast<guard_condition_info_t *>(gc->data);
+
+  // Triggers add up until they're taken, and taking resets them
+  EXPECT_EQ(0u, hazcat_guard_condition_take(gc_impl));
+  ASSERT_EQ(RMW_RET_OK, rmw_trigger_guard_condition(gc));
+  ASSERT_EQ(RMW_RET_OK, rmw_trigger_guard_condition(gc));
+  ASSERT_EQ(RMW_RET_OK, rmw_trigger_guard_condition(gc));
+  EXPECT_EQ(3u, hazcat_guard_condition_take(gc_impl));
+  EXPECT_EQ(0u, hazcat_guard_condition_take(gc_impl));
+
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_guard_condition(gc));
+}
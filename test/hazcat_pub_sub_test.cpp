@@ -0,0 +1,260 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "osrf_testing_tools_cpp/scope_exit.hpp"
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/message_sequence.h"
+#include "rmw/rmw.h"
+
+#include "rosidl_runtime_c/string_functions.h"
+
+#include "test_msgs/msg/basic_types.h"
+#include "test_msgs/msg/strings.h"
+
+class TestPubSub : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rmw_init_options_t options = rmw_get_zero_initialized_init_options();
+    rmw_ret_t ret = rmw_init_options_init(&options, rcutils_get_default_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+    {
+      rmw_ret_t ret = rmw_init_options_fini(&options);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    });
+    options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", options.enclave);
+    context = rmw_get_zero_initialized_context();
+    ret = rmw_init(&options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    node = rmw_create_node(&context, "test_pub_sub", "/", 0, false);
+    ASSERT_NE(nullptr, node) << rcutils_get_error_string().str;
+  }
+
+  void TearDown() override
+  {
+    rmw_ret_t ret = rmw_destroy_node(node);
+    EXPECT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    ret = rmw_shutdown(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    ret = rmw_context_fini(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+  }
+
+  rmw_context_t context;
+  rmw_node_t * node;
+};
+
+TEST_F(TestPubSub, oversized_message) {
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Strings);
+  rmw_qos_profile_t qos = rmw_qos_profile_default;
+  qos.depth = 2;
+  rmw_publisher_options_t pub_opts = rmw_get_default_publisher_options();
+  rmw_subscription_options_t sub_opts = rmw_get_default_subscription_options();
+
+  rmw_publisher_t * pub = rmw_create_publisher(node, type_support, "/oversized", &qos, &pub_opts);
+  ASSERT_NE(nullptr, pub) << rcutils_get_error_string().str;
+  rmw_subscription_t * sub =
+    rmw_create_subscription(node, type_support, "/oversized", &qos, &sub_opts);
+  ASSERT_NE(nullptr, sub) << rcutils_get_error_string().str;
+
+  test_msgs__msg__Strings msg;
+  ASSERT_TRUE(test_msgs__msg__Strings__init(&msg));
+  test_msgs__msg__Strings received;
+  ASSERT_TRUE(test_msgs__msg__Strings__init(&received));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    test_msgs__msg__Strings__fini(&msg);
+    test_msgs__msg__Strings__fini(&received);
+  });
+
+  // Far more than the blocks rmw_hazcat starts a type with unbounded strings on, so the publisher
+  // moves to larger ones
+  std::string large(64 * 1024, 'x');
+  ASSERT_TRUE(rosidl_runtime_c__String__assign(&msg.string_value, large.c_str()));
+  ASSERT_EQ(RMW_RET_OK, rmw_publish(pub, &msg, nullptr)) << rcutils_get_error_string().str;
+
+  bool taken = false;
+  ASSERT_EQ(RMW_RET_OK, rmw_take(sub, &received, &taken, nullptr));
+  ASSERT_TRUE(taken);
+  EXPECT_EQ(large, std::string(received.string_value.data, received.string_value.size));
+
+  // Small messages keep going through the larger blocks
+  ASSERT_TRUE(rosidl_runtime_c__String__assign(&msg.string_value, "small"));
+  ASSERT_EQ(RMW_RET_OK, rmw_publish(pub, &msg, nullptr)) << rcutils_get_error_string().str;
+  ASSERT_EQ(RMW_RET_OK, rmw_take(sub, &received, &taken, nullptr));
+  ASSERT_TRUE(taken);
+  EXPECT_STREQ("small", received.string_value.data);
+
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub));
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, pub));
+}
+
+TEST_F(TestPubSub, take_sequence) {
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+  rmw_qos_profile_t qos = rmw_qos_profile_default;
+  qos.depth = 5;
+  rmw_publisher_options_t pub_opts = rmw_get_default_publisher_options();
+  rmw_subscription_options_t sub_opts = rmw_get_default_subscription_options();
+
+  rmw_publisher_t * pub = rmw_create_publisher(node, type_support, "/sequence", &qos, &pub_opts);
+  ASSERT_NE(nullptr, pub) << rcutils_get_error_string().str;
+  rmw_subscription_t * sub =
+    rmw_create_subscription(node, type_support, "/sequence", &qos, &sub_opts);
+  ASSERT_NE(nullptr, sub) << rcutils_get_error_string().str;
+
+  constexpr size_t kCapacity = 8;
+  test_msgs__msg__BasicTypes msgs[kCapacity];
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_message_sequence_t message_sequence = rmw_get_zero_initialized_message_sequence();
+  ASSERT_EQ(RMW_RET_OK, rmw_message_sequence_init(&message_sequence, kCapacity, &allocator));
+  rmw_message_info_sequence_t info_sequence = rmw_get_zero_initialized_message_info_sequence();
+  ASSERT_EQ(RMW_RET_OK, rmw_message_info_sequence_init(&info_sequence, kCapacity, &allocator));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_message_sequence_fini(&message_sequence));
+    EXPECT_EQ(RMW_RET_OK, rmw_message_info_sequence_fini(&info_sequence));
+  });
+  for (size_t i = 0; i < kCapacity; i++) {
+    ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&msgs[i]));
+    message_sequence.data[i] = &msgs[i];
+  }
+
+  // Fewer messages than asked for, taken in the order they were published
+  test_msgs__msg__BasicTypes msg;
+  ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&msg));
+  for (int32_t i = 1; i <= 3; i++) {
+    msg.int32_value = i;
+    ASSERT_EQ(RMW_RET_OK, rmw_publish(pub, &msg, nullptr)) << rcutils_get_error_string().str;
+  }
+  size_t taken = 0;
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_take_sequence(sub, kCapacity, &message_sequence, &info_sequence, &taken, nullptr)) <<
+    rcutils_get_error_string().str;
+  ASSERT_EQ(3u, taken);
+  EXPECT_EQ(3u, message_sequence.size);
+  EXPECT_EQ(3u, info_sequence.size);
+  for (size_t i = 0; i < taken; i++) {
+    EXPECT_EQ(static_cast<int32_t>(i + 1), msgs[i].int32_value);
+    EXPECT_EQ(i + 1, info_sequence.data[i].publication_sequence_number);
+  }
+
+  // A whole queue's worth brings the queue index back to where the subscriber left off, and all of
+  // it must still be taken
+  for (int32_t i = 4; i < 4 + static_cast<int32_t>(qos.depth); i++) {
+    msg.int32_value = i;
+    ASSERT_EQ(RMW_RET_OK, rmw_publish(pub, &msg, nullptr)) << rcutils_get_error_string().str;
+  }
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_take_sequence(sub, kCapacity, &message_sequence, &info_sequence, &taken, nullptr)) <<
+    rcutils_get_error_string().str;
+  ASSERT_EQ(qos.depth, taken);
+  for (size_t i = 0; i < taken; i++) {
+    EXPECT_EQ(static_cast<int32_t>(i + 4), msgs[i].int32_value);
+  }
+
+  // Nothing left
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_take_sequence(sub, kCapacity, &message_sequence, &info_sequence, &taken, nullptr));
+  EXPECT_EQ(0u, taken);
+
+  test_msgs__msg__BasicTypes__fini(&msg);
+  for (size_t i = 0; i < kCapacity; i++) {
+    test_msgs__msg__BasicTypes__fini(&msgs[i]);
+  }
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub));
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, pub));
+}
+
+TEST_F(TestPubSub, message_lost) {
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+  rmw_qos_profile_t qos = rmw_qos_profile_default;
+  qos.depth = 3;
+  rmw_publisher_options_t pub_opts = rmw_get_default_publisher_options();
+  rmw_subscription_options_t sub_opts = rmw_get_default_subscription_options();
+
+  rmw_publisher_t * pub = rmw_create_publisher(node, type_support, "/lost", &qos, &pub_opts);
+  ASSERT_NE(nullptr, pub) << rcutils_get_error_string().str;
+  rmw_subscription_t * sub = rmw_create_subscription(node, type_support, "/lost", &qos, &sub_opts);
+  ASSERT_NE(nullptr, sub) << rcutils_get_error_string().str;
+  rmw_event_t event;
+  ASSERT_EQ(RMW_RET_OK, rmw_subscription_event_init(&event, sub, RMW_EVENT_MESSAGE_LOST)) <<
+    rcutils_get_error_string().str;
+
+  test_msgs__msg__BasicTypes msg;
+  ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&msg));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(test_msgs__msg__BasicTypes__fini(&msg));
+  rmw_message_info_t info = rmw_get_zero_initialized_message_info();
+  bool taken = false;
+
+  // The first message from the publisher is what later ones are compared against
+  ASSERT_EQ(RMW_RET_OK, rmw_publish(pub, &msg, nullptr));
+  ASSERT_EQ(RMW_RET_OK, rmw_take_with_info(sub, &msg, &taken, &info, nullptr));
+  ASSERT_TRUE(taken);
+  ASSERT_EQ(1u, info.publication_sequence_number);
+  rmw_message_lost_status_t status;
+  ASSERT_EQ(RMW_RET_OK, rmw_take_event(&event, &status, &taken));
+  EXPECT_EQ(0u, status.total_count);
+  EXPECT_EQ(0u, status.total_count_change);
+
+  // More than two laps of the queue, so the subscriber is lapped however the queue counts
+  const uint64_t published = 1 + 2 * qos.depth + 1;
+  for (uint64_t i = 2; i <= published; i++) {
+    ASSERT_EQ(RMW_RET_OK, rmw_publish(pub, &msg, nullptr));
+  }
+  uint64_t taken_after = 0;
+  uint64_t last = 1;
+  for (;; ) {
+    ASSERT_EQ(RMW_RET_OK, rmw_take_with_info(sub, &msg, &taken, &info, nullptr));
+    if (!taken) {
+      break;
+    }
+    EXPECT_GT(info.publication_sequence_number, last);
+    last = info.publication_sequence_number;
+    taken_after++;
+  }
+  EXPECT_EQ(published, last);
+  ASSERT_GT(taken_after, 0u);
+  ASSERT_LE(taken_after, qos.depth);
+
+  // Everything published after the first message and not taken was lost
+  const size_t lost = static_cast<size_t>(published - 1 - taken_after);
+  ASSERT_EQ(RMW_RET_OK, rmw_take_event(&event, &status, &taken));
+  EXPECT_EQ(lost, status.total_count);
+  EXPECT_EQ(lost, status.total_count_change);
+
+  // Taking the event again reports no change
+  ASSERT_EQ(RMW_RET_OK, rmw_take_event(&event, &status, &taken));
+  EXPECT_EQ(lost, status.total_count);
+  EXPECT_EQ(0u, status.total_count_change);
+
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub));
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, pub));
+}
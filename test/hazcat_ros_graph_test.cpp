@@ -0,0 +1,321 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "osrf_testing_tools_cpp/scope_exit.hpp"
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+#include "rcutils/types/string_array.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/names_and_types.h"
+#include "rmw/rmw.h"
+#include "rmw/topic_endpoint_info_array.h"
+
+#include "rmw_hazcat/hazcat_ros_graph.h"
+
+// The graph is shared by every process on the host, so everything a test adds is named after the
+// test process, and tests only look for their own entries
+class TestRosGraph : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rmw_init_options_t options = rmw_get_zero_initialized_init_options();
+    rmw_ret_t ret = rmw_init_options_init(&options, rcutils_get_default_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+    {
+      rmw_ret_t ret = rmw_init_options_fini(&options);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    });
+    options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", options.enclave);
+    context = rmw_get_zero_initialized_context();
+    ret = rmw_init(&options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    node = rmw_create_node(&context, "test_ros_graph", "/", 0, false);
+    ASSERT_NE(nullptr, node) << rcutils_get_error_string().str;
+
+    suffix = std::to_string(getpid());
+    node_name = "graph_test_" + suffix;
+    prefix = "/graph_test_" + suffix + "/";
+  }
+
+  void TearDown() override
+  {
+    rmw_ret_t ret = rmw_destroy_node(node);
+    EXPECT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    ret = rmw_shutdown(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    ret = rmw_context_fini(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+  }
+
+  // Add a node named node_name, in the test node's context
+  int32_t add_node()
+  {
+    rmw_node_t fake = *node;
+    fake.name = node_name.c_str();
+    fake.namespace_ = "/graph_test";
+    int32_t slot = -1;
+    EXPECT_EQ(RMW_RET_OK, hazcat_graph_add_node(&fake, &slot)) << rmw_get_error_string().str;
+    return slot;
+  }
+
+  int32_t add_endpoint(
+    int32_t node_slot, graph_endpoint_kind_t kind, const std::string & topic, const char * type,
+    uint8_t gid_byte = 0, size_t depth = 10)
+  {
+    rmw_gid_t gid;
+    gid.implementation_identifier = rmw_get_implementation_identifier();
+    memset(gid.data, gid_byte, RMW_GID_STORAGE_SIZE);
+    rmw_qos_profile_t qos = rmw_qos_profile_default;
+    qos.depth = depth;
+    int32_t slot = -1;
+    EXPECT_EQ(
+      RMW_RET_OK,
+      hazcat_graph_add_endpoint(node_slot, kind, topic.c_str(), type, &gid, &qos, &slot)) <<
+      rmw_get_error_string().str;
+    return slot;
+  }
+
+  bool has_node(const std::string & name)
+  {
+    rcutils_string_array_t names = rcutils_get_zero_initialized_string_array();
+    rcutils_string_array_t namespaces = rcutils_get_zero_initialized_string_array();
+    EXPECT_EQ(RMW_RET_OK, hazcat_graph_get_node_names(&names, &namespaces, nullptr));
+    bool found = false;
+    for (size_t i = 0; i < names.size; i++) {
+      if (name == names.data[i]) {
+        EXPECT_STREQ("/graph_test", namespaces.data[i]);
+        found = true;
+      }
+    }
+    EXPECT_EQ(RCUTILS_RET_OK, rcutils_string_array_fini(&names));
+    EXPECT_EQ(RCUTILS_RET_OK, rcutils_string_array_fini(&namespaces));
+    return found;
+  }
+
+  rmw_context_t context;
+  rmw_node_t * node;
+  std::string suffix;
+  std::string node_name;
+  std::string prefix;             // Of every topic the test adds
+};
+
+TEST_F(TestRosGraph, add_and_remove) {
+  EXPECT_FALSE(has_node(node_name));
+  int32_t slot = add_node();
+  ASSERT_LE(0, slot);
+  EXPECT_TRUE(has_node(node_name));
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_remove_node(slot));
+  EXPECT_FALSE(has_node(node_name));
+}
+
+TEST_F(TestRosGraph, count) {
+  std::string topic = prefix + "count";
+  int32_t node_slot = add_node();
+  size_t publishers = 99, subscriptions = 99;
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_count(topic.c_str(), &publishers, &subscriptions));
+  EXPECT_EQ(0u, publishers);
+  EXPECT_EQ(0u, subscriptions);
+
+  int32_t pub1 = add_endpoint(node_slot, GRAPH_PUBLISHER, topic, "test_msgs/msg/BasicTypes");
+  int32_t pub2 = add_endpoint(node_slot, GRAPH_PUBLISHER, topic, "test_msgs/msg/BasicTypes");
+  int32_t sub = add_endpoint(node_slot, GRAPH_SUBSCRIPTION, topic, "test_msgs/msg/BasicTypes");
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_count(topic.c_str(), &publishers, &subscriptions));
+  EXPECT_EQ(2u, publishers);
+  EXPECT_EQ(1u, subscriptions);
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_count(topic.c_str(), nullptr, &subscriptions));
+  EXPECT_EQ(1u, subscriptions);
+
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_remove_endpoint(pub1));
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_count(topic.c_str(), &publishers, &subscriptions));
+  EXPECT_EQ(1u, publishers);
+  EXPECT_EQ(1u, subscriptions);
+
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_remove_endpoint(pub2));
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_remove_endpoint(sub));
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_count(topic.c_str(), &publishers, &subscriptions));
+  EXPECT_EQ(0u, publishers);
+  EXPECT_EQ(0u, subscriptions);
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_remove_node(node_slot));
+}
+
+TEST_F(TestRosGraph, endpoint_info) {
+  std::string topic = prefix + "info";
+  int32_t node_slot = add_node();
+  int32_t pub = add_endpoint(node_slot, GRAPH_PUBLISHER, topic, "test_msgs/msg/Strings", 0xAB, 7);
+  int32_t sub = add_endpoint(node_slot, GRAPH_SUBSCRIPTION, topic, "test_msgs/msg/Strings", 0xCD);
+
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_topic_endpoint_info_array_t info = rmw_get_zero_initialized_topic_endpoint_info_array();
+  ASSERT_EQ(
+    RMW_RET_OK,
+    hazcat_graph_get_endpoint_info(topic.c_str(), GRAPH_PUBLISHER, &allocator, &info)) <<
+    rmw_get_error_string().str;
+  ASSERT_EQ(1u, info.size);
+  EXPECT_STREQ(node_name.c_str(), info.info_array[0].node_name);
+  EXPECT_STREQ("/graph_test", info.info_array[0].node_namespace);
+  EXPECT_STREQ("test_msgs/msg/Strings", info.info_array[0].topic_type);
+  EXPECT_EQ(RMW_ENDPOINT_PUBLISHER, info.info_array[0].endpoint_type);
+  EXPECT_EQ(0xAB, info.info_array[0].endpoint_gid[0]);
+  EXPECT_EQ(0xAB, info.info_array[0].endpoint_gid[RMW_GID_STORAGE_SIZE - 1]);
+  EXPECT_EQ(7u, info.info_array[0].qos_profile.depth);
+  ASSERT_EQ(RMW_RET_OK, rmw_topic_endpoint_info_array_fini(&info, &allocator));
+
+  info = rmw_get_zero_initialized_topic_endpoint_info_array();
+  ASSERT_EQ(
+    RMW_RET_OK,
+    hazcat_graph_get_endpoint_info(topic.c_str(), GRAPH_SUBSCRIPTION, &allocator, &info));
+  ASSERT_EQ(1u, info.size);
+  EXPECT_EQ(RMW_ENDPOINT_SUBSCRIPTION, info.info_array[0].endpoint_type);
+  EXPECT_EQ(0xCD, info.info_array[0].endpoint_gid[0]);
+  ASSERT_EQ(RMW_RET_OK, rmw_topic_endpoint_info_array_fini(&info, &allocator));
+
+  // Nothing on a topic nobody uses
+  info = rmw_get_zero_initialized_topic_endpoint_info_array();
+  std::string unused = prefix + "unused";
+  ASSERT_EQ(
+    RMW_RET_OK,
+    hazcat_graph_get_endpoint_info(unused.c_str(), GRAPH_PUBLISHER, &allocator, &info));
+  EXPECT_EQ(0u, info.size);
+  ASSERT_EQ(RMW_RET_OK, rmw_topic_endpoint_info_array_fini(&info, &allocator));
+
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_remove_endpoint(pub));
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_remove_endpoint(sub));
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_remove_node(node_slot));
+}
+
+// Types of name in names_and_types, comma separated, or "" if it isn't there
+static std::string
+types_of(const rmw_names_and_types_t & names_and_types, const std::string & name)
+{
+  for (size_t i = 0; i < names_and_types.names.size; i++) {
+    if (name == names_and_types.names.data[i]) {
+      std::string types;
+      for (size_t t = 0; t < names_and_types.types[i].size; t++) {
+        types += (0 == t ? "" : ",") + std::string(names_and_types.types[i].data[t]);
+      }
+      return types;
+    }
+  }
+  return "";
+}
+
+TEST_F(TestRosGraph, names_and_types) {
+  std::string a = prefix + "a";
+  std::string b = prefix + "b";
+  std::string request = "rq" + prefix + "srvRequest";
+  int32_t node_slot = add_node();
+  int32_t other_slot = add_node();
+  int32_t slots[] = {
+    add_endpoint(node_slot, GRAPH_PUBLISHER, a, "test_msgs/msg/Strings"),
+    add_endpoint(node_slot, GRAPH_PUBLISHER, a, "test_msgs/msg/Strings"),
+    add_endpoint(other_slot, GRAPH_PUBLISHER, a, "test_msgs/msg/BasicTypes"),
+    add_endpoint(other_slot, GRAPH_SUBSCRIPTION, b, "test_msgs/msg/Nested"),
+    add_endpoint(node_slot, GRAPH_SUBSCRIPTION, request, "test_msgs/srv/BasicTypes_Request"),
+  };
+
+  // Every kind, types sorted and without duplicates, and internal topics left out
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_names_and_types_t names_and_types = rmw_get_zero_initialized_names_and_types();
+  ASSERT_EQ(
+    RMW_RET_OK, hazcat_graph_get_names_and_types(
+      nullptr, nullptr, GRAPH_PUBLISHER | GRAPH_SUBSCRIPTION, false, false, &allocator,
+      &names_and_types)) << rmw_get_error_string().str;
+  EXPECT_EQ("test_msgs/msg/BasicTypes,test_msgs/msg/Strings", types_of(names_and_types, a));
+  EXPECT_EQ("test_msgs/msg/Nested", types_of(names_and_types, b));
+  EXPECT_EQ("", types_of(names_and_types, request));
+  ASSERT_EQ(RMW_RET_OK, rmw_names_and_types_fini(&names_and_types));
+
+  // Only publishers of one node
+  ASSERT_EQ(
+    RMW_RET_OK, hazcat_graph_get_names_and_types(
+      node_name.c_str(), "/graph_test", GRAPH_PUBLISHER, false, false, &allocator,
+      &names_and_types));
+  EXPECT_EQ("test_msgs/msg/Strings", types_of(names_and_types, a));
+  EXPECT_EQ("", types_of(names_and_types, b));
+  ASSERT_EQ(RMW_RET_OK, rmw_names_and_types_fini(&names_and_types));
+
+  // Services are found behind their request topics
+  ASSERT_EQ(
+    RMW_RET_OK, hazcat_graph_get_names_and_types(
+      nullptr, nullptr, GRAPH_SUBSCRIPTION, true, false, &allocator, &names_and_types));
+  EXPECT_EQ("test_msgs/srv/BasicTypes", types_of(names_and_types, prefix + "srv"));
+  ASSERT_EQ(RMW_RET_OK, rmw_names_and_types_fini(&names_and_types));
+
+  // A node that doesn't exist
+  EXPECT_EQ(
+    RMW_RET_NODE_NAME_NON_EXISTENT, hazcat_graph_get_names_and_types(
+      "no_such_node", "/graph_test", GRAPH_PUBLISHER, false, false, &allocator,
+      &names_and_types));
+  rmw_reset_error();
+
+  for (int32_t slot : slots) {
+    ASSERT_EQ(RMW_RET_OK, hazcat_graph_remove_endpoint(slot));
+  }
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_remove_node(node_slot));
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_remove_node(other_slot));
+}
+
+TEST_F(TestRosGraph, count_alive_across_pid_namespaces) {
+  std::string topic = prefix + "alive";
+  int32_t node_slot = add_node();
+  int32_t pub = add_endpoint(node_slot, GRAPH_PUBLISHER, topic, "test_msgs/msg/BasicTypes");
+  int32_t alive, not_alive;
+  int64_t next_expiry;
+  ASSERT_EQ(
+    RMW_RET_OK, hazcat_graph_count_alive(topic.c_str(), 0, &alive, &not_alive, &next_expiry));
+  EXPECT_EQ(1, alive);
+  EXPECT_EQ(0, not_alive);
+  EXPECT_EQ(0, next_expiry);
+
+  // Pretend the publisher belonged to a process that has since exited
+  pid_t child = fork();
+  ASSERT_NE(-1, child);
+  if (0 == child) {
+    _exit(0);
+  }
+  ASSERT_EQ(child, waitpid(child, nullptr, 0));
+  graph_t * g;
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_attach(&g));
+  graph_process_t process = g->endpoints[pub].process;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(g->endpoints[pub].process = process);
+  g->endpoints[pub].process.pid = child;
+  ASSERT_EQ(
+    RMW_RET_OK, hazcat_graph_count_alive(topic.c_str(), 0, &alive, &not_alive, &next_expiry));
+  EXPECT_EQ(0, alive);
+  EXPECT_EQ(1, not_alive);
+
+  // The same pid in another PID namespace says nothing about the process, which is assumed alive
+  g->endpoints[pub].process.pid_ns = process.pid_ns + 1;
+  ASSERT_EQ(
+    RMW_RET_OK, hazcat_graph_count_alive(topic.c_str(), 0, &alive, &not_alive, &next_expiry));
+  EXPECT_EQ(1, alive);
+  EXPECT_EQ(0, not_alive);
+
+  g->endpoints[pub].process = process;
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_remove_endpoint(pub));
+  ASSERT_EQ(RMW_RET_OK, hazcat_graph_remove_node(node_slot));
+}
@@ -0,0 +1,809 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "osrf_testing_tools_cpp/scope_exit.hpp"
+
+#include "rcutils/allocator.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+#include "rmw/serialized_message.h"
+
+#include "rosidl_runtime_c/primitives_sequence_functions.h"
+#include "rosidl_runtime_c/string_functions.h"
+#include "rosidl_runtime_c/u16string_functions.h"
+
+#include "rosidl_typesupport_cpp/message_type_support.hpp"
+
+#include "test_msgs/msg/arrays.h"
+#include "test_msgs/msg/basic_types.h"
+#include "test_msgs/msg/bounded_sequences.h"
+#include "test_msgs/msg/defaults.h"
+#include "test_msgs/msg/multi_nested.h"
+#include "test_msgs/msg/nested.h"
+#include "test_msgs/msg/strings.h"
+#include "test_msgs/msg/unbounded_sequences.h"
+#include "test_msgs/msg/w_strings.h"
+
+#include "test_msgs/msg/basic_types.hpp"
+#include "test_msgs/msg/bounded_sequences.hpp"
+#include "test_msgs/msg/multi_nested.hpp"
+#include "test_msgs/msg/strings.hpp"
+#include "test_msgs/msg/unbounded_sequences.hpp"
+#include "test_msgs/msg/w_strings.hpp"
+
+// Size of the CDR encapsulation header, and the size BasicTypes encodes to after it
+#define ENCAPSULATION_SIZE 4
+#define BASIC_TYPES_CDR_SIZE 48
+
+static bool
+machine_is_little_endian()
+{
+  uint16_t one = 1;
+  return 1 == *reinterpret_cast<uint8_t *>(&one);
+}
+
+// Builds big endian CDR by hand, aligning each value to its size relative to the end of the
+// encapsulation header
+class BigEndianWriter
+{
+public:
+  BigEndianWriter()
+  : bytes_{0x00, 0x00, 0x00, 0x00}
+  {
+  }
+
+  void put(uint64_t value, size_t size)
+  {
+    while (0 != (bytes_.size() - ENCAPSULATION_SIZE) % size) {
+      bytes_.push_back(0);
+    }
+    for (size_t i = size; i > 0; i--) {
+      bytes_.push_back(static_cast<uint8_t>(value >> (8 * (i - 1))));
+    }
+  }
+
+  // A view of the bytes written so far, valid until the next put
+  rmw_serialized_message_t message()
+  {
+    rmw_serialized_message_t message = rmw_get_zero_initialized_serialized_message();
+    message.buffer = bytes_.data();
+    message.buffer_length = bytes_.size();
+    message.buffer_capacity = bytes_.size();
+    return message;
+  }
+
+private:
+  std::vector<uint8_t> bytes_;
+};
+
+class TestSerialize : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rcutils_allocator_t allocator = rcutils_get_default_allocator();
+    serialized = rmw_get_zero_initialized_serialized_message();
+    // Deliberately small, so encoding has to grow it
+    ASSERT_EQ(RMW_RET_OK, rmw_serialized_message_init(&serialized, 16, &allocator));
+  }
+
+  void TearDown() override
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_serialized_message_fini(&serialized));
+  }
+
+  // Encode in with type_support into serialized, then decode that into out
+  void round_trip(const rosidl_message_type_support_t * type_support, const void * in, void * out)
+  {
+    ASSERT_EQ(RMW_RET_OK, rmw_serialize(in, type_support, &serialized)) <<
+      rmw_get_error_string().str;
+    ASSERT_GE(serialized.buffer_length, static_cast<size_t>(ENCAPSULATION_SIZE));
+    ASSERT_LE(serialized.buffer_length, serialized.buffer_capacity);
+    ASSERT_EQ(RMW_RET_OK, rmw_deserialize(&serialized, type_support, out)) <<
+      rmw_get_error_string().str;
+  }
+
+  rmw_serialized_message_t serialized;
+};
+
+static void
+fill_basic_types(test_msgs__msg__BasicTypes * msg, int seed)
+{
+  msg->bool_value = (0 == seed % 2);
+  msg->byte_value = static_cast<uint8_t>(0xA0 + seed);
+  msg->char_value = static_cast<uint8_t>('a' + seed);
+  msg->float32_value = 1.5f * seed;
+  msg->float64_value = -2.25 * seed;
+  msg->int8_value = static_cast<int8_t>(-seed);
+  msg->uint8_value = static_cast<uint8_t>(200 + seed);
+  msg->int16_value = static_cast<int16_t>(-1000 * seed);
+  msg->uint16_value = static_cast<uint16_t>(60000 + seed);
+  msg->int32_value = -100000 * seed;
+  msg->uint32_value = 4000000000u + seed;
+  msg->int64_value = -10000000000LL * seed;
+  msg->uint64_value = 18000000000000000000ULL + seed;
+}
+
+static void
+expect_basic_types_eq(const test_msgs__msg__BasicTypes & a, const test_msgs__msg__BasicTypes & b)
+{
+  EXPECT_EQ(a.bool_value, b.bool_value);
+  EXPECT_EQ(a.byte_value, b.byte_value);
+  EXPECT_EQ(a.char_value, b.char_value);
+  EXPECT_EQ(a.float32_value, b.float32_value);
+  EXPECT_EQ(a.float64_value, b.float64_value);
+  EXPECT_EQ(a.int8_value, b.int8_value);
+  EXPECT_EQ(a.uint8_value, b.uint8_value);
+  EXPECT_EQ(a.int16_value, b.int16_value);
+  EXPECT_EQ(a.uint16_value, b.uint16_value);
+  EXPECT_EQ(a.int32_value, b.int32_value);
+  EXPECT_EQ(a.uint32_value, b.uint32_value);
+  EXPECT_EQ(a.int64_value, b.int64_value);
+  EXPECT_EQ(a.uint64_value, b.uint64_value);
+}
+
+static std::u16string
+to_u16(const rosidl_runtime_c__U16String & str)
+{
+  return std::u16string(reinterpret_cast<const char16_t *>(str.data), str.size);
+}
+
+static bool
+assign_u16(rosidl_runtime_c__U16String * str, const char16_t * value)
+{
+  return rosidl_runtime_c__U16String__assign(str, reinterpret_cast<const uint16_t *>(value));
+}
+
+TEST_F(TestSerialize, primitives) {
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+  test_msgs__msg__BasicTypes in, out;
+  ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&in));
+  ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&out));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    test_msgs__msg__BasicTypes__fini(&in);
+    test_msgs__msg__BasicTypes__fini(&out);
+  });
+
+  fill_basic_types(&in, 3);
+  round_trip(type_support, &in, &out);
+  EXPECT_EQ(
+    static_cast<size_t>(ENCAPSULATION_SIZE + BASIC_TYPES_CDR_SIZE), serialized.buffer_length);
+  expect_basic_types_eq(in, out);
+}
+
+TEST_F(TestSerialize, encapsulation_header) {
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+  test_msgs__msg__BasicTypes msg;
+  ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&msg));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(test_msgs__msg__BasicTypes__fini(&msg));
+
+  // Plain CDR in the machine's byte order, with no options
+  ASSERT_EQ(RMW_RET_OK, rmw_serialize(&msg, type_support, &serialized));
+  EXPECT_EQ(0x00, serialized.buffer[0]);
+  EXPECT_EQ(machine_is_little_endian() ? 0x01 : 0x00, serialized.buffer[1]);
+  EXPECT_EQ(0x00, serialized.buffer[2]);
+  EXPECT_EQ(0x00, serialized.buffer[3]);
+
+  // Too short to hold the header, or the body it announces
+  rmw_serialized_message_t truncated = serialized;
+  truncated.buffer_length = ENCAPSULATION_SIZE - 1;
+  EXPECT_EQ(RMW_RET_ERROR, rmw_deserialize(&truncated, type_support, &msg));
+  rmw_reset_error();
+  truncated.buffer_length = serialized.buffer_length - 1;
+  EXPECT_EQ(RMW_RET_ERROR, rmw_deserialize(&truncated, type_support, &msg));
+  rmw_reset_error();
+}
+
+TEST_F(TestSerialize, big_endian) {
+  // Whatever the machine, a message encoded big endian is decoded by the header's say so
+  BigEndianWriter writer;
+  uint32_t float32_bits;
+  uint64_t float64_bits;
+  float float32_value = 1.5f;
+  double float64_value = -2.25;
+  memcpy(&float32_bits, &float32_value, sizeof(float32_bits));
+  memcpy(&float64_bits, &float64_value, sizeof(float64_bits));
+  writer.put(1, 1);                       // bool_value
+  writer.put(0xAB, 1);                    // byte_value
+  writer.put('z', 1);                     // char_value
+  writer.put(float32_bits, 4);            // float32_value
+  writer.put(float64_bits, 8);            // float64_value
+  writer.put(0xFE, 1);                    // int8_value, -2
+  writer.put(250, 1);                     // uint8_value
+  writer.put(0xFC18, 2);                  // int16_value, -1000
+  writer.put(0xFDE8, 2);                  // uint16_value, 65000
+  writer.put(0xFFFE7960, 4);              // int32_value, -100000
+  writer.put(0x12345678, 4);              // uint32_value
+  writer.put(0xFFFFFFFDABF41C00ULL, 8);   // int64_value, -10000000000
+  writer.put(0x0123456789ABCDEFULL, 8);   // uint64_value
+  rmw_serialized_message_t message = writer.message();
+  ASSERT_EQ(static_cast<size_t>(ENCAPSULATION_SIZE + BASIC_TYPES_CDR_SIZE), message.buffer_length);
+
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+  test_msgs__msg__BasicTypes msg;
+  ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&msg));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(test_msgs__msg__BasicTypes__fini(&msg));
+  ASSERT_EQ(RMW_RET_OK, rmw_deserialize(&message, type_support, &msg)) <<
+    rmw_get_error_string().str;
+  EXPECT_TRUE(msg.bool_value);
+  EXPECT_EQ(0xAB, msg.byte_value);
+  EXPECT_EQ('z', msg.char_value);
+  EXPECT_EQ(1.5f, msg.float32_value);
+  EXPECT_EQ(-2.25, msg.float64_value);
+  EXPECT_EQ(-2, msg.int8_value);
+  EXPECT_EQ(250, msg.uint8_value);
+  EXPECT_EQ(-1000, msg.int16_value);
+  EXPECT_EQ(65000, msg.uint16_value);
+  EXPECT_EQ(-100000, msg.int32_value);
+  EXPECT_EQ(0x12345678u, msg.uint32_value);
+  EXPECT_EQ(-10000000000LL, msg.int64_value);
+  EXPECT_EQ(0x0123456789ABCDEFULL, msg.uint64_value);
+}
+
+TEST_F(TestSerialize, strings) {
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Strings);
+  test_msgs__msg__Strings in, out;
+  ASSERT_TRUE(test_msgs__msg__Strings__init(&in));
+  ASSERT_TRUE(test_msgs__msg__Strings__init(&out));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    test_msgs__msg__Strings__fini(&in);
+    test_msgs__msg__Strings__fini(&out);
+  });
+
+  // Long enough that the encoding has to grow well past the struct
+  std::string long_string(1000, 'x');
+  ASSERT_TRUE(rosidl_runtime_c__String__assign(&in.string_value, long_string.c_str()));
+  ASSERT_TRUE(rosidl_runtime_c__String__assign(&in.bounded_string_value, "bounded"));
+  ASSERT_TRUE(rosidl_runtime_c__String__assign(&in.string_value_default1, ""));
+  round_trip(type_support, &in, &out);
+  EXPECT_EQ(long_string, out.string_value.data);
+  EXPECT_STREQ("bounded", out.bounded_string_value.data);
+  EXPECT_STREQ("", out.string_value_default1.data);
+  EXPECT_STREQ(in.string_value_default2.data, out.string_value_default2.data);
+  EXPECT_STREQ(in.bounded_string_value_default5.data, out.bounded_string_value_default5.data);
+
+  // A bounded string longer than its bound is refused when decoding
+  ASSERT_TRUE(rosidl_runtime_c__String__assign(&in.bounded_string_value, long_string.c_str()));
+  ASSERT_EQ(RMW_RET_OK, rmw_serialize(&in, type_support, &serialized));
+  EXPECT_EQ(RMW_RET_ERROR, rmw_deserialize(&serialized, type_support, &out));
+  rmw_reset_error();
+}
+
+TEST_F(TestSerialize, wstrings) {
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, WStrings);
+  test_msgs__msg__WStrings in, out;
+  ASSERT_TRUE(test_msgs__msg__WStrings__init(&in));
+  ASSERT_TRUE(test_msgs__msg__WStrings__init(&out));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    test_msgs__msg__WStrings__fini(&in);
+    test_msgs__msg__WStrings__fini(&out);
+  });
+
+  ASSERT_TRUE(assign_u16(&in.wstring_value, u"H\u00e9llo w\u00f6rld \u4e16\u754c"));
+  ASSERT_TRUE(assign_u16(&in.array_of_wstrings[0], u"zero"));
+  ASSERT_TRUE(assign_u16(&in.array_of_wstrings[2], u"two"));
+  ASSERT_TRUE(rosidl_runtime_c__U16String__Sequence__init(&in.bounded_sequence_of_wstrings, 2));
+  ASSERT_TRUE(assign_u16(&in.bounded_sequence_of_wstrings.data[1], u"bounded"));
+  ASSERT_TRUE(rosidl_runtime_c__U16String__Sequence__init(&in.unbounded_sequence_of_wstrings, 5));
+  for (size_t i = 0; i < 5; i++) {
+    std::u16string value(i * 10, u'\u00fc');
+    ASSERT_TRUE(assign_u16(&in.unbounded_sequence_of_wstrings.data[i], value.c_str()));
+  }
+  round_trip(type_support, &in, &out);
+
+  EXPECT_EQ(to_u16(in.wstring_value), to_u16(out.wstring_value));
+  for (size_t i = 0; i < 3; i++) {
+    EXPECT_EQ(to_u16(in.array_of_wstrings[i]), to_u16(out.array_of_wstrings[i]));
+  }
+  ASSERT_EQ(2u, out.bounded_sequence_of_wstrings.size);
+  EXPECT_EQ(u"", to_u16(out.bounded_sequence_of_wstrings.data[0]));
+  EXPECT_EQ(u"bounded", to_u16(out.bounded_sequence_of_wstrings.data[1]));
+  ASSERT_EQ(5u, out.unbounded_sequence_of_wstrings.size);
+  for (size_t i = 0; i < 5; i++) {
+    EXPECT_EQ(
+      to_u16(in.unbounded_sequence_of_wstrings.data[i]),
+      to_u16(out.unbounded_sequence_of_wstrings.data[i]));
+  }
+}
+
+TEST_F(TestSerialize, unbounded_sequences) {
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, UnboundedSequences);
+  test_msgs__msg__UnboundedSequences in, out;
+  ASSERT_TRUE(test_msgs__msg__UnboundedSequences__init(&in));
+  ASSERT_TRUE(test_msgs__msg__UnboundedSequences__init(&out));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    test_msgs__msg__UnboundedSequences__fini(&in);
+    test_msgs__msg__UnboundedSequences__fini(&out);
+  });
+
+  // Odd lengths, so every sequence after the bools and bytes has to be realigned
+  ASSERT_TRUE(rosidl_runtime_c__boolean__Sequence__init(&in.bool_values, 3));
+  in.bool_values.data[1] = true;
+  ASSERT_TRUE(rosidl_runtime_c__octet__Sequence__init(&in.byte_values, 1));
+  in.byte_values.data[0] = 0x7F;
+  ASSERT_TRUE(rosidl_runtime_c__int32__Sequence__init(&in.int32_values, 1001));
+  for (size_t i = 0; i < in.int32_values.size; i++) {
+    in.int32_values.data[i] = static_cast<int32_t>(i * i) - 500;
+  }
+  ASSERT_TRUE(rosidl_runtime_c__double__Sequence__init(&in.float64_values, 7));
+  for (size_t i = 0; i < in.float64_values.size; i++) {
+    in.float64_values.data[i] = 0.125 * i;
+  }
+  ASSERT_TRUE(rosidl_runtime_c__String__Sequence__init(&in.string_values, 3));
+  ASSERT_TRUE(rosidl_runtime_c__String__assign(&in.string_values.data[0], "a"));
+  ASSERT_TRUE(rosidl_runtime_c__String__assign(&in.string_values.data[2], "ccc"));
+  ASSERT_TRUE(test_msgs__msg__BasicTypes__Sequence__init(&in.basic_types_values, 2));
+  fill_basic_types(&in.basic_types_values.data[0], 1);
+  fill_basic_types(&in.basic_types_values.data[1], 2);
+  in.alignment_check = 0x5A5A5A5A;
+  round_trip(type_support, &in, &out);
+
+  ASSERT_EQ(3u, out.bool_values.size);
+  EXPECT_FALSE(out.bool_values.data[0]);
+  EXPECT_TRUE(out.bool_values.data[1]);
+  EXPECT_FALSE(out.bool_values.data[2]);
+  ASSERT_EQ(1u, out.byte_values.size);
+  EXPECT_EQ(0x7F, out.byte_values.data[0]);
+  EXPECT_EQ(0u, out.char_values.size);
+  ASSERT_EQ(in.int32_values.size, out.int32_values.size);
+  EXPECT_EQ(
+    0, memcmp(in.int32_values.data, out.int32_values.data, in.int32_values.size * sizeof(int32_t)));
+  ASSERT_EQ(in.float64_values.size, out.float64_values.size);
+  for (size_t i = 0; i < in.float64_values.size; i++) {
+    EXPECT_EQ(in.float64_values.data[i], out.float64_values.data[i]);
+  }
+  ASSERT_EQ(3u, out.string_values.size);
+  EXPECT_STREQ("a", out.string_values.data[0].data);
+  EXPECT_STREQ("", out.string_values.data[1].data);
+  EXPECT_STREQ("ccc", out.string_values.data[2].data);
+  ASSERT_EQ(2u, out.basic_types_values.size);
+  expect_basic_types_eq(in.basic_types_values.data[0], out.basic_types_values.data[0]);
+  expect_basic_types_eq(in.basic_types_values.data[1], out.basic_types_values.data[1]);
+  ASSERT_EQ(in.int16_values_default.size, out.int16_values_default.size);
+  for (size_t i = 0; i < in.int16_values_default.size; i++) {
+    EXPECT_EQ(in.int16_values_default.data[i], out.int16_values_default.data[i]);
+  }
+  EXPECT_EQ(0x5A5A5A5A, out.alignment_check);
+
+  // Decoding shrinks sequences that were longer than what's encoded
+  in.int32_values.size = 0;
+  round_trip(type_support, &in, &out);
+  EXPECT_EQ(0u, out.int32_values.size);
+}
+
+TEST_F(TestSerialize, bounded_sequences) {
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BoundedSequences);
+  test_msgs__msg__BoundedSequences in, out;
+  ASSERT_TRUE(test_msgs__msg__BoundedSequences__init(&in));
+  ASSERT_TRUE(test_msgs__msg__BoundedSequences__init(&out));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    test_msgs__msg__BoundedSequences__fini(&in);
+    test_msgs__msg__BoundedSequences__fini(&out);
+  });
+
+  ASSERT_TRUE(rosidl_runtime_c__float__Sequence__init(&in.float32_values, 3));
+  in.float32_values.data[0] = 1.0f;
+  in.float32_values.data[2] = -3.0f;
+  ASSERT_TRUE(rosidl_runtime_c__uint64__Sequence__init(&in.uint64_values, 2));
+  in.uint64_values.data[1] = UINT64_MAX;
+  ASSERT_TRUE(rosidl_runtime_c__String__Sequence__init(&in.string_values, 1));
+  ASSERT_TRUE(rosidl_runtime_c__String__assign(&in.string_values.data[0], "only"));
+  ASSERT_TRUE(test_msgs__msg__BasicTypes__Sequence__init(&in.basic_types_values, 3));
+  fill_basic_types(&in.basic_types_values.data[2], 5);
+  in.alignment_check = -7;
+  round_trip(type_support, &in, &out);
+
+  ASSERT_EQ(3u, out.float32_values.size);
+  EXPECT_EQ(1.0f, out.float32_values.data[0]);
+  EXPECT_EQ(0.0f, out.float32_values.data[1]);
+  EXPECT_EQ(-3.0f, out.float32_values.data[2]);
+  ASSERT_EQ(2u, out.uint64_values.size);
+  EXPECT_EQ(0u, out.uint64_values.data[0]);
+  EXPECT_EQ(UINT64_MAX, out.uint64_values.data[1]);
+  ASSERT_EQ(1u, out.string_values.size);
+  EXPECT_STREQ("only", out.string_values.data[0].data);
+  ASSERT_EQ(3u, out.basic_types_values.size);
+  expect_basic_types_eq(in.basic_types_values.data[2], out.basic_types_values.data[2]);
+  EXPECT_EQ(-7, out.alignment_check);
+}
+
+TEST_F(TestSerialize, sequence_over_bound) {
+  // UnboundedSequences has the same fields as BoundedSequences, minus the bounds
+  test_msgs__msg__UnboundedSequences unbounded;
+  ASSERT_TRUE(test_msgs__msg__UnboundedSequences__init(&unbounded));
+  test_msgs__msg__BoundedSequences bounded;
+  ASSERT_TRUE(test_msgs__msg__BoundedSequences__init(&bounded));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    test_msgs__msg__UnboundedSequences__fini(&unbounded);
+    test_msgs__msg__BoundedSequences__fini(&bounded);
+  });
+
+  ASSERT_TRUE(rosidl_runtime_c__boolean__Sequence__init(&unbounded.bool_values, 4));
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_serialize(
+      &unbounded, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, UnboundedSequences), &serialized));
+  EXPECT_EQ(
+    RMW_RET_ERROR, rmw_deserialize(
+      &serialized, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BoundedSequences), &bounded));
+  rmw_reset_error();
+}
+
+TEST_F(TestSerialize, nested) {
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Nested);
+  test_msgs__msg__Nested in, out;
+  ASSERT_TRUE(test_msgs__msg__Nested__init(&in));
+  ASSERT_TRUE(test_msgs__msg__Nested__init(&out));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    test_msgs__msg__Nested__fini(&in);
+    test_msgs__msg__Nested__fini(&out);
+  });
+
+  fill_basic_types(&in.basic_types_value, 7);
+  round_trip(type_support, &in, &out);
+  EXPECT_EQ(
+    static_cast<size_t>(ENCAPSULATION_SIZE + BASIC_TYPES_CDR_SIZE), serialized.buffer_length);
+  expect_basic_types_eq(in.basic_types_value, out.basic_types_value);
+}
+
+TEST_F(TestSerialize, arrays) {
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Arrays);
+  test_msgs__msg__Arrays in, out;
+  ASSERT_TRUE(test_msgs__msg__Arrays__init(&in));
+  ASSERT_TRUE(test_msgs__msg__Arrays__init(&out));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    test_msgs__msg__Arrays__fini(&in);
+    test_msgs__msg__Arrays__fini(&out);
+  });
+
+  for (size_t i = 0; i < 3; i++) {
+    in.bool_values[i] = (1 == i);
+    in.int16_values[i] = static_cast<int16_t>(-300 * i);
+    in.float64_values[i] = 1e100 * i;
+    fill_basic_types(&in.basic_types_values[i], static_cast<int>(i) + 1);
+  }
+  ASSERT_TRUE(rosidl_runtime_c__String__assign(&in.string_values[1], "middle"));
+  in.alignment_check = 42;
+  round_trip(type_support, &in, &out);
+
+  for (size_t i = 0; i < 3; i++) {
+    EXPECT_EQ(in.bool_values[i], out.bool_values[i]);
+    EXPECT_EQ(in.int16_values[i], out.int16_values[i]);
+    EXPECT_EQ(in.float64_values[i], out.float64_values[i]);
+    EXPECT_STREQ(in.string_values[i].data, out.string_values[i].data);
+    expect_basic_types_eq(in.basic_types_values[i], out.basic_types_values[i]);
+  }
+  EXPECT_EQ(42, out.alignment_check);
+}
+
+TEST_F(TestSerialize, multi_nested) {
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, MultiNested);
+  test_msgs__msg__MultiNested in, out;
+  ASSERT_TRUE(test_msgs__msg__MultiNested__init(&in));
+  ASSERT_TRUE(test_msgs__msg__MultiNested__init(&out));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    test_msgs__msg__MultiNested__fini(&in);
+    test_msgs__msg__MultiNested__fini(&out);
+  });
+
+  // Sequences inside arrays inside sequences, each flattened into the plan of the one around it
+  in.array_of_arrays[1].int32_values[2] = 12;
+  ASSERT_TRUE(
+    rosidl_runtime_c__int32__Sequence__init(&in.array_of_unbounded_sequences[2].int32_values, 4));
+  in.array_of_unbounded_sequences[2].int32_values.data[3] = 34;
+  ASSERT_TRUE(test_msgs__msg__Arrays__Sequence__init(&in.bounded_sequence_of_arrays, 2));
+  ASSERT_TRUE(
+    rosidl_runtime_c__String__assign(&in.bounded_sequence_of_arrays.data[1].string_values[0], "s"));
+  ASSERT_TRUE(
+    test_msgs__msg__UnboundedSequences__Sequence__init(
+      &in.unbounded_sequence_of_unbounded_sequences, 3));
+  test_msgs__msg__UnboundedSequences * last = &in.unbounded_sequence_of_unbounded_sequences.data[2];
+  ASSERT_TRUE(test_msgs__msg__BasicTypes__Sequence__init(&last->basic_types_values, 2));
+  fill_basic_types(&last->basic_types_values.data[1], 9);
+  last->alignment_check = 56;
+  round_trip(type_support, &in, &out);
+
+  EXPECT_EQ(12, out.array_of_arrays[1].int32_values[2]);
+  ASSERT_EQ(4u, out.array_of_unbounded_sequences[2].int32_values.size);
+  EXPECT_EQ(34, out.array_of_unbounded_sequences[2].int32_values.data[3]);
+  ASSERT_EQ(2u, out.bounded_sequence_of_arrays.size);
+  EXPECT_STREQ("s", out.bounded_sequence_of_arrays.data[1].string_values[0].data);
+  ASSERT_EQ(3u, out.unbounded_sequence_of_unbounded_sequences.size);
+  const test_msgs__msg__UnboundedSequences * last_out =
+    &out.unbounded_sequence_of_unbounded_sequences.data[2];
+  ASSERT_EQ(2u, last_out->basic_types_values.size);
+  expect_basic_types_eq(last->basic_types_values.data[1], last_out->basic_types_values.data[1]);
+  EXPECT_EQ(56, last_out->alignment_check);
+}
+
+TEST_F(TestSerialize, plan_reuse) {
+  // The first encoding builds the type's plan, later ones must come out the same through it
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Arrays);
+  test_msgs__msg__Arrays msg;
+  ASSERT_TRUE(test_msgs__msg__Arrays__init(&msg));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(test_msgs__msg__Arrays__fini(&msg));
+  for (size_t i = 0; i < 3; i++) {
+    msg.uint64_values[i] = 0x0101010101010101ULL * (i + 1);
+    fill_basic_types(&msg.basic_types_values[i], static_cast<int>(i));
+  }
+
+  ASSERT_EQ(RMW_RET_OK, rmw_serialize(&msg, type_support, &serialized));
+  std::vector<uint8_t> first(serialized.buffer, serialized.buffer + serialized.buffer_length);
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(RMW_RET_OK, rmw_serialize(&msg, type_support, &serialized));
+    ASSERT_EQ(first.size(), serialized.buffer_length);
+    EXPECT_EQ(0, memcmp(first.data(), serialized.buffer, first.size()));
+  }
+}
+
+TEST_F(TestSerialize, misaligned_buffer) {
+  // Runs of primitives are only copied in bulk when the buffer lines up with the message. A
+  // buffer that doesn't must still decode field by field to the same result
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Arrays);
+  test_msgs__msg__Arrays in, out;
+  ASSERT_TRUE(test_msgs__msg__Arrays__init(&in));
+  ASSERT_TRUE(test_msgs__msg__Arrays__init(&out));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    test_msgs__msg__Arrays__fini(&in);
+    test_msgs__msg__Arrays__fini(&out);
+  });
+  for (size_t i = 0; i < 3; i++) {
+    in.float32_values[i] = 0.5f * i;
+    in.int64_values[i] = -1 - static_cast<int64_t>(i);
+    in.uint16_values[i] = static_cast<uint16_t>(i + 1);
+    fill_basic_types(&in.basic_types_values[i], static_cast<int>(i) + 4);
+  }
+  ASSERT_EQ(RMW_RET_OK, rmw_serialize(&in, type_support, &serialized));
+
+  for (size_t shift = 1; shift < 8; shift++) {
+    std::vector<uint8_t> copy(shift + serialized.buffer_length);
+    memcpy(copy.data() + shift, serialized.buffer, serialized.buffer_length);
+    rmw_serialized_message_t shifted = rmw_get_zero_initialized_serialized_message();
+    shifted.buffer = copy.data() + shift;
+    shifted.buffer_length = serialized.buffer_length;
+    shifted.buffer_capacity = serialized.buffer_length;
+    ASSERT_EQ(RMW_RET_OK, rmw_deserialize(&shifted, type_support, &out)) <<
+      rmw_get_error_string().str;
+    for (size_t i = 0; i < 3; i++) {
+      EXPECT_EQ(in.float32_values[i], out.float32_values[i]);
+      EXPECT_EQ(in.int64_values[i], out.int64_values[i]);
+      EXPECT_EQ(in.uint16_values[i], out.uint16_values[i]);
+      expect_basic_types_eq(in.basic_types_values[i], out.basic_types_values[i]);
+    }
+  }
+}
+
+TEST_F(TestSerialize, concurrent_first_use) {
+  // Threads racing to build the first plan for a type must all get a working one
+  const rosidl_message_type_support_t * type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Defaults);
+  test_msgs__msg__Defaults msg;
+  ASSERT_TRUE(test_msgs__msg__Defaults__init(&msg));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(test_msgs__msg__Defaults__fini(&msg));
+
+  constexpr size_t kThreads = 8;
+  std::vector<std::vector<uint8_t>> encodings(kThreads);
+  std::vector<rmw_ret_t> rets(kThreads, RMW_RET_ERROR);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; t++) {
+    threads.emplace_back(
+      [&, t]() {
+        rcutils_allocator_t allocator = rcutils_get_default_allocator();
+        rmw_serialized_message_t own = rmw_get_zero_initialized_serialized_message();
+        if (RMW_RET_OK != rmw_serialized_message_init(&own, 16, &allocator)) {
+          return;
+        }
+        rets[t] = rmw_serialize(&msg, type_support, &own);
+        encodings[t].assign(own.buffer, own.buffer + own.buffer_length);
+        (void)rmw_serialized_message_fini(&own);
+      });
+  }
+  for (std::thread & thread : threads) {
+    thread.join();
+  }
+  for (size_t t = 0; t < kThreads; t++) {
+    EXPECT_EQ(RMW_RET_OK, rets[t]);
+    EXPECT_EQ(encodings[0], encodings[t]);
+  }
+}
+
+// Encode in with C++ type support and decode it into a fresh message of the same type
+template<typename MessageT>
+static MessageT
+cpp_round_trip(const MessageT & in, rmw_serialized_message_t * serialized)
+{
+  const rosidl_message_type_support_t * type_support =
+    rosidl_typesupport_cpp::get_message_type_support_handle<MessageT>();
+  MessageT out;
+  EXPECT_EQ(RMW_RET_OK, rmw_serialize(&in, type_support, serialized)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_OK, rmw_deserialize(serialized, type_support, &out)) <<
+    rmw_get_error_string().str;
+  return out;
+}
+
+static void
+fill_basic_types(test_msgs::msg::BasicTypes * msg, int seed)
+{
+  msg->bool_value = (0 == seed % 2);
+  msg->byte_value = static_cast<uint8_t>(0xA0 + seed);
+  msg->char_value = static_cast<uint8_t>('a' + seed);
+  msg->float32_value = 1.5f * seed;
+  msg->float64_value = -2.25 * seed;
+  msg->int8_value = static_cast<int8_t>(-seed);
+  msg->uint8_value = static_cast<uint8_t>(200 + seed);
+  msg->int16_value = static_cast<int16_t>(-1000 * seed);
+  msg->uint16_value = static_cast<uint16_t>(60000 + seed);
+  msg->int32_value = -100000 * seed;
+  msg->uint32_value = 4000000000u + seed;
+  msg->int64_value = -10000000000LL * seed;
+  msg->uint64_value = 18000000000000000000ULL + seed;
+}
+
+TEST_F(TestSerialize, cpp_primitives_and_strings) {
+  test_msgs::msg::BasicTypes basic_types;
+  fill_basic_types(&basic_types, 3);
+  EXPECT_EQ(basic_types, cpp_round_trip(basic_types, &serialized));
+  EXPECT_EQ(
+    static_cast<size_t>(ENCAPSULATION_SIZE + BASIC_TYPES_CDR_SIZE), serialized.buffer_length);
+
+  test_msgs::msg::Strings strings;
+  strings.string_value = std::string(1000, 'x');
+  strings.bounded_string_value = "bounded";
+  strings.string_value_default1.clear();
+  EXPECT_EQ(strings, cpp_round_trip(strings, &serialized));
+
+  test_msgs::msg::WStrings wstrings;
+  wstrings.wstring_value = u"H\u00e9llo w\u00f6rld \u4e16\u754c";
+  wstrings.array_of_wstrings[2] = u"two";
+  wstrings.bounded_sequence_of_wstrings.push_back(u"");
+  wstrings.bounded_sequence_of_wstrings.push_back(u"bounded");
+  for (size_t i = 0; i < 5; i++) {
+    wstrings.unbounded_sequence_of_wstrings.push_back(std::u16string(i * 10, u'\u00fc'));
+  }
+  EXPECT_EQ(wstrings, cpp_round_trip(wstrings, &serialized));
+}
+
+TEST_F(TestSerialize, cpp_sequences_and_nesting) {
+  // std::vector<bool> packs its bits, so it can't be handed to microcdr as an array
+  test_msgs::msg::UnboundedSequences unbounded;
+  unbounded.bool_values = {false, true, false, true, true};
+  unbounded.byte_values = {0x7F};
+  for (int32_t i = 0; i < 1001; i++) {
+    unbounded.int32_values.push_back(i * i - 500);
+  }
+  unbounded.string_values = {"a", "", "ccc"};
+  unbounded.basic_types_values.resize(2);
+  fill_basic_types(&unbounded.basic_types_values[1], 2);
+  unbounded.alignment_check = 0x5A5A5A5A;
+  EXPECT_EQ(unbounded, cpp_round_trip(unbounded, &serialized));
+
+  test_msgs::msg::BoundedSequences bounded;
+  bounded.float32_values.push_back(1.0f);
+  bounded.uint64_values.push_back(UINT64_MAX);
+  bounded.basic_types_values.resize(3);
+  fill_basic_types(&bounded.basic_types_values[2], 5);
+  bounded.alignment_check = -7;
+  EXPECT_EQ(bounded, cpp_round_trip(bounded, &serialized));
+
+  // Over the bound on the wire, so decoding as BoundedSequences fails
+  unbounded.bool_values.resize(4);
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_serialize(
+      &unbounded,
+      rosidl_typesupport_cpp::get_message_type_support_handle<test_msgs::msg::UnboundedSequences>(),
+      &serialized));
+  EXPECT_EQ(
+    RMW_RET_ERROR, rmw_deserialize(
+      &serialized,
+      rosidl_typesupport_cpp::get_message_type_support_handle<test_msgs::msg::BoundedSequences>(),
+      &bounded));
+  rmw_reset_error();
+
+  test_msgs::msg::MultiNested multi_nested;
+  multi_nested.array_of_arrays[1].int32_values[2] = 12;
+  multi_nested.array_of_unbounded_sequences[2].int32_values = {0, 0, 0, 34};
+  multi_nested.bounded_sequence_of_arrays.resize(2);
+  multi_nested.bounded_sequence_of_arrays[1].string_values[0] = "s";
+  multi_nested.unbounded_sequence_of_unbounded_sequences.resize(3);
+  multi_nested.unbounded_sequence_of_unbounded_sequences[2].basic_types_values.resize(2);
+  multi_nested.unbounded_sequence_of_unbounded_sequences[2].alignment_check = 56;
+  EXPECT_EQ(multi_nested, cpp_round_trip(multi_nested, &serialized));
+}
+
+TEST_F(TestSerialize, cross_flavour) {
+  // The same message encodes to the same bytes whether it's C or C++, and decodes into either
+  test_msgs__msg__UnboundedSequences c_msg;
+  ASSERT_TRUE(test_msgs__msg__UnboundedSequences__init(&c_msg));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(test_msgs__msg__UnboundedSequences__fini(&c_msg));
+  ASSERT_TRUE(rosidl_runtime_c__boolean__Sequence__init(&c_msg.bool_values, 3));
+  c_msg.bool_values.data[1] = true;
+  ASSERT_TRUE(rosidl_runtime_c__int16__Sequence__init(&c_msg.int16_values, 2));
+  c_msg.int16_values.data[0] = -2;
+  c_msg.int16_values.data[1] = 300;
+  ASSERT_TRUE(rosidl_runtime_c__String__Sequence__init(&c_msg.string_values, 2));
+  ASSERT_TRUE(rosidl_runtime_c__String__assign(&c_msg.string_values.data[1], "second"));
+  ASSERT_TRUE(test_msgs__msg__BasicTypes__Sequence__init(&c_msg.basic_types_values, 1));
+  fill_basic_types(&c_msg.basic_types_values.data[0], 6);
+  c_msg.alignment_check = 77;
+
+  test_msgs::msg::UnboundedSequences cpp_msg;
+  cpp_msg.bool_values = {false, true, false};
+  cpp_msg.int16_values = {-2, 300};
+  cpp_msg.string_values = {"", "second"};
+  cpp_msg.basic_types_values.resize(1);
+  fill_basic_types(&cpp_msg.basic_types_values[0], 6);
+  cpp_msg.alignment_check = 77;
+
+  const rosidl_message_type_support_t * c_type_support =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, UnboundedSequences);
+  const rosidl_message_type_support_t * cpp_type_support =
+    rosidl_typesupport_cpp::get_message_type_support_handle<test_msgs::msg::UnboundedSequences>();
+  ASSERT_EQ(RMW_RET_OK, rmw_serialize(&c_msg, c_type_support, &serialized));
+  std::vector<uint8_t> from_c(serialized.buffer, serialized.buffer + serialized.buffer_length);
+  ASSERT_EQ(RMW_RET_OK, rmw_serialize(&cpp_msg, cpp_type_support, &serialized));
+  std::vector<uint8_t> from_cpp(serialized.buffer, serialized.buffer + serialized.buffer_length);
+  EXPECT_EQ(from_c, from_cpp);
+
+  // C++ to C
+  test_msgs__msg__UnboundedSequences c_out;
+  ASSERT_TRUE(test_msgs__msg__UnboundedSequences__init(&c_out));
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(test_msgs__msg__UnboundedSequences__fini(&c_out));
+  ASSERT_EQ(RMW_RET_OK, rmw_deserialize(&serialized, c_type_support, &c_out));
+  ASSERT_EQ(3u, c_out.bool_values.size);
+  EXPECT_TRUE(c_out.bool_values.data[1]);
+  ASSERT_EQ(2u, c_out.int16_values.size);
+  EXPECT_EQ(300, c_out.int16_values.data[1]);
+  ASSERT_EQ(2u, c_out.string_values.size);
+  EXPECT_STREQ("second", c_out.string_values.data[1].data);
+  ASSERT_EQ(1u, c_out.basic_types_values.size);
+  expect_basic_types_eq(c_msg.basic_types_values.data[0], c_out.basic_types_values.data[0]);
+  EXPECT_EQ(77, c_out.alignment_check);
+
+  // C to C++
+  ASSERT_EQ(RMW_RET_OK, rmw_serialize(&c_msg, c_type_support, &serialized));
+  test_msgs::msg::UnboundedSequences cpp_out;
+  ASSERT_EQ(RMW_RET_OK, rmw_deserialize(&serialized, cpp_type_support, &cpp_out));
+  EXPECT_EQ(cpp_msg, cpp_out);
+}
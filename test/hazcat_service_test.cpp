@@ -0,0 +1,245 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+#include "osrf_testing_tools_cpp/scope_exit.hpp"
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/get_service_names_and_types.h"
+#include "rmw/names_and_types.h"
+#include "rmw/rmw.h"
+
+#include "test_msgs/srv/basic_types.h"
+
+#include "rmw_hazcat/hazcat_service.h"
+
+class TestService : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rmw_init_options_t options = rmw_get_zero_initialized_init_options();
+    rmw_ret_t ret = rmw_init_options_init(&options, rcutils_get_default_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+    {
+      rmw_ret_t ret = rmw_init_options_fini(&options);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    });
+    options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", options.enclave);
+    context = rmw_get_zero_initialized_context();
+    ret = rmw_init(&options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    node = rmw_create_node(&context, "test_service", "/", 0, false);
+    ASSERT_NE(nullptr, node) << rcutils_get_error_string().str;
+    ASSERT_TRUE(test_msgs__srv__BasicTypes_Request__init(&request));
+    ASSERT_TRUE(test_msgs__srv__BasicTypes_Response__init(&response));
+  }
+
+  void TearDown() override
+  {
+    test_msgs__srv__BasicTypes_Request__fini(&request);
+    test_msgs__srv__BasicTypes_Response__fini(&response);
+    rmw_ret_t ret = rmw_destroy_node(node);
+    EXPECT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    ret = rmw_shutdown(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    ret = rmw_context_fini(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+  }
+
+  // Send a request carrying value from client, returning its sequence number
+  int64_t send(const rmw_client_t * client, int64_t value)
+  {
+    request.int64_value = value;
+    int64_t sequence_id = 0;
+    EXPECT_EQ(RMW_RET_OK, rmw_send_request(client, &request, &sequence_id)) <<
+      rcutils_get_error_string().str;
+    return sequence_id;
+  }
+
+  // Take the next request from service and answer it with twice its value
+  void answer(const rmw_service_t * service)
+  {
+    rmw_service_info_t header;
+    bool taken = false;
+    ASSERT_EQ(RMW_RET_OK, rmw_take_request(service, &header, &request, &taken)) <<
+      rcutils_get_error_string().str;
+    ASSERT_TRUE(taken);
+    response.int64_value = 2 * request.int64_value;
+    ASSERT_EQ(RMW_RET_OK, rmw_send_response(service, &header.request_id, &response)) <<
+      rcutils_get_error_string().str;
+  }
+
+  // Take the next response for client, checking it answers the request with sequence_id and value
+  void expect_response(const rmw_client_t * client, int64_t sequence_id, int64_t value)
+  {
+    rmw_service_info_t header;
+    bool taken = false;
+    ASSERT_EQ(RMW_RET_OK, rmw_take_response(client, &header, &response, &taken)) <<
+      rcutils_get_error_string().str;
+    ASSERT_TRUE(taken);
+    EXPECT_EQ(sequence_id, header.request_id.sequence_number);
+    EXPECT_EQ(2 * value, response.int64_value);
+    const client_info_t * info = static_cast<const client_info_t *>(client->data);
+    EXPECT_EQ(0, memcmp(header.request_id.writer_guid, &info->gid, sizeof(gid_layout_t)));
+  }
+
+  rmw_context_t context;
+  rmw_node_t * node;
+  const rosidl_service_type_support_t * type_support =
+    ROSIDL_GET_SRV_TYPE_SUPPORT(test_msgs, srv, BasicTypes);
+  rmw_qos_profile_t qos = rmw_qos_profile_services_default;
+  test_msgs__srv__BasicTypes_Request request;
+  test_msgs__srv__BasicTypes_Response response;
+};
+
+TEST_F(TestService, round_trip) {
+  rmw_client_t * client = rmw_create_client(node, type_support, "/round_trip", &qos);
+  ASSERT_NE(nullptr, client) << rcutils_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_client(node, client));
+  });
+
+  bool is_available = true;
+  ASSERT_EQ(RMW_RET_OK, rmw_service_server_is_available(node, client, &is_available));
+  EXPECT_FALSE(is_available);
+
+  rmw_service_t * service = rmw_create_service(node, type_support, "/round_trip", &qos);
+  ASSERT_NE(nullptr, service) << rcutils_get_error_string().str;
+  ASSERT_EQ(RMW_RET_OK, rmw_service_server_is_available(node, client, &is_available));
+  EXPECT_TRUE(is_available);
+
+  // Listed under the service's own name and type, not those of its request topic
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_names_and_types_t names_and_types = rmw_get_zero_initialized_names_and_types();
+  ASSERT_EQ(RMW_RET_OK, rmw_get_service_names_and_types(node, &allocator, &names_and_types));
+  bool listed = false;
+  for (size_t i = 0; i < names_and_types.names.size; i++) {
+    if (std::string("/round_trip") == names_and_types.names.data[i]) {
+      listed = true;
+      ASSERT_EQ(1u, names_and_types.types[i].size);
+      EXPECT_STREQ("test_msgs/srv/BasicTypes", names_and_types.types[i].data[0]);
+    }
+  }
+  EXPECT_TRUE(listed);
+  ASSERT_EQ(RMW_RET_OK, rmw_names_and_types_fini(&names_and_types));
+
+  int64_t first = send(client, 21);
+  int64_t second = send(client, 50);
+  EXPECT_EQ(first + 1, second);
+  answer(service);
+  answer(service);
+  expect_response(client, first, 21);
+  expect_response(client, second, 50);
+
+  // Nothing more to take on either side
+  rmw_service_info_t header;
+  bool taken = true;
+  ASSERT_EQ(RMW_RET_OK, rmw_take_request(service, &header, &request, &taken));
+  EXPECT_FALSE(taken);
+  ASSERT_EQ(RMW_RET_OK, rmw_take_response(client, &header, &response, &taken));
+  EXPECT_FALSE(taken);
+
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_service(node, service));
+  ASSERT_EQ(RMW_RET_OK, rmw_service_server_is_available(node, client, &is_available));
+  EXPECT_FALSE(is_available);
+}
+
+TEST_F(TestService, interleaved_clients) {
+  rmw_service_t * service = rmw_create_service(node, type_support, "/interleaved", &qos);
+  ASSERT_NE(nullptr, service) << rcutils_get_error_string().str;
+  rmw_client_t * a = rmw_create_client(node, type_support, "/interleaved", &qos);
+  ASSERT_NE(nullptr, a) << rcutils_get_error_string().str;
+  rmw_client_t * b = rmw_create_client(node, type_support, "/interleaved", &qos);
+  ASSERT_NE(nullptr, b) << rcutils_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_client(node, b));
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_client(node, a));
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_service(node, service));
+  });
+
+  // Both clients number their requests from 1, so only the client tells them apart
+  int64_t a1 = send(a, 1);
+  int64_t b1 = send(b, 10);
+  int64_t a2 = send(a, 2);
+  int64_t b2 = send(b, 20);
+  EXPECT_EQ(a1, b1);
+  EXPECT_EQ(a2, b2);
+  for (int i = 0; i < 4; i++) {
+    answer(service);
+  }
+
+  // Each client only sees the responses to its own requests, in order
+  expect_response(a, a1, 1);
+  expect_response(a, a2, 2);
+  expect_response(b, b1, 10);
+  expect_response(b, b2, 20);
+  rmw_service_info_t header;
+  bool taken = true;
+  ASSERT_EQ(RMW_RET_OK, rmw_take_response(a, &header, &response, &taken));
+  EXPECT_FALSE(taken);
+  ASSERT_EQ(RMW_RET_OK, rmw_take_response(b, &header, &response, &taken));
+  EXPECT_FALSE(taken);
+
+  const service_info_t * info = static_cast<const service_info_t *>(service->data);
+  EXPECT_EQ(2u, info->responder_count);
+}
+
+TEST_F(TestService, responder_reclaimed) {
+  rmw_service_t * service = rmw_create_service(node, type_support, "/reclaimed", &qos);
+  ASSERT_NE(nullptr, service) << rcutils_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_service(node, service));
+  });
+  const service_info_t * info = static_cast<const service_info_t *>(service->data);
+
+  rmw_client_t * gone = rmw_create_client(node, type_support, "/reclaimed", &qos);
+  ASSERT_NE(nullptr, gone) << rcutils_get_error_string().str;
+  int64_t sequence_id = send(gone, 3);
+  answer(service);
+  expect_response(gone, sequence_id, 3);
+  EXPECT_EQ(1u, info->responder_count);
+
+  // A request still pending when its client goes away is answered into the void
+  send(gone, 4);
+  ASSERT_EQ(RMW_RET_OK, rmw_destroy_client(node, gone));
+  answer(service);
+  EXPECT_EQ(1u, info->responder_count);
+
+  // Answering a new client reclaims the responder of the one that's gone
+  rmw_client_t * client = rmw_create_client(node, type_support, "/reclaimed", &qos);
+  ASSERT_NE(nullptr, client) << rcutils_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_client(node, client));
+  });
+  sequence_id = send(client, 5);
+  answer(service);
+  expect_response(client, sequence_id, 5);
+  ASSERT_EQ(1u, info->responder_count);
+  const client_info_t * client_info = static_cast<const client_info_t *>(client->data);
+  EXPECT_EQ(0, memcmp(&info->responders[0].client, &client_info->gid, sizeof(gid_layout_t)));
+}
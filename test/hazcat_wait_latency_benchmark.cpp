@@ -0,0 +1,174 @@
+// Copyright 2022 Washington University in St Louis
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rosidl_runtime_c/message_type_support_struct.h"
+#include "test_msgs/msg/basic_types.h"
+
+#include "rmw_hazcat/hazcat_wait_set.h"
+
+// Number of messages timed for each wait mode
+constexpr size_t kSamples = 2000;
+
+// Gap between a message being taken and the next one being published, so the waiting thread has
+// time to get back into rmw_wait
+constexpr int64_t kPublishGapNs = 100000;
+
+// Spin budget for the spinning mode, comfortably longer than kPublishGapNs
+constexpr uint64_t kSpinNs = 1000000;
+
+static int64_t
+now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+class WaitLatencyBenchmark : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rmw_init_options_t options = rmw_get_zero_initialized_init_options();
+    ASSERT_EQ(RMW_RET_OK, rmw_init_options_init(&options, rcutils_get_default_allocator())) <<
+      rcutils_get_error_string().str;
+    options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    context = rmw_get_zero_initialized_context();
+    ASSERT_EQ(RMW_RET_OK, rmw_init(&options, &context)) << rcutils_get_error_string().str;
+    ASSERT_EQ(RMW_RET_OK, rmw_init_options_fini(&options)) << rcutils_get_error_string().str;
+
+    node = rmw_create_node(&context, "wait_latency_node", "/", 1, true);
+    ASSERT_NE(nullptr, node) << rcutils_get_error_string().str;
+
+    const rosidl_message_type_support_t * type_support =
+      ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+    rmw_qos_profile_t qos = rmw_qos_profile_system_default;
+    qos.depth = 10;
+    rmw_publisher_options_t pub_opts = rmw_get_default_publisher_options();
+    rmw_subscription_options_t sub_opts = rmw_get_default_subscription_options();
+    pub = rmw_create_publisher(node, type_support, "/wait_latency", &qos, &pub_opts);
+    ASSERT_NE(nullptr, pub) << rcutils_get_error_string().str;
+    sub = rmw_create_subscription(node, type_support, "/wait_latency", &qos, &sub_opts);
+    ASSERT_NE(nullptr, sub) << rcutils_get_error_string().str;
+  }
+
+  void TearDown() override
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub)) << rcutils_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, pub)) << rcutils_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_node(node)) << rcutils_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_shutdown(&context)) << rcutils_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_context_fini(&context)) << rcutils_get_error_string().str;
+  }
+
+  // Publish kSamples messages stamped with their publication time, one at a time, and record how
+  // long after publication rmw_wait returned with each of them
+  void measure(uint64_t spin_ns, std::vector<int64_t> & latencies)
+  {
+    rmw_wait_set_t * wait_set = rmw_create_wait_set(&context, 1);
+    ASSERT_NE(nullptr, wait_set) << rcutils_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_hazcat_wait_set_set_spin(wait_set, spin_ns));
+
+    std::atomic_size_t taken_count(0);
+    std::thread publisher([&]() {
+        test_msgs__msg__BasicTypes msg;
+        test_msgs__msg__BasicTypes__init(&msg);
+        for (size_t i = 0; i < kSamples; i++) {
+          while (taken_count.load() < i) {
+            std::this_thread::yield();
+          }
+          int64_t start = now_ns();
+          while (now_ns() - start < kPublishGapNs) {
+            std::this_thread::yield();
+          }
+          msg.int64_value = now_ns();
+          EXPECT_EQ(RMW_RET_OK, rmw_publish(pub, &msg, nullptr));
+        }
+        test_msgs__msg__BasicTypes__fini(&msg);
+      });
+
+    test_msgs__msg__BasicTypes msg;
+    test_msgs__msg__BasicTypes__init(&msg);
+    rmw_time_t timeout = {1, 0};
+    while (latencies.size() < kSamples) {
+      void * subscribers[1] = {sub->data};
+      rmw_subscriptions_t subscriptions = {1, subscribers};
+      rmw_ret_t ret =
+        rmw_wait(&subscriptions, nullptr, nullptr, nullptr, nullptr, wait_set, &timeout);
+      int64_t woke = now_ns();
+      bool taken = false;
+      if (RMW_RET_OK != ret || nullptr == subscribers[0] ||
+        RMW_RET_OK != rmw_take(sub, &msg, &taken, nullptr) || !taken)
+      {
+        ADD_FAILURE() << "message lost after " << latencies.size() << " samples: " <<
+          rcutils_get_error_string().str;
+        break;
+      }
+      latencies.push_back(woke - msg.int64_value);
+      taken_count.store(latencies.size());
+    }
+    test_msgs__msg__BasicTypes__fini(&msg);
+
+    // Let the publisher run out if we stopped early
+    taken_count.store(kSamples);
+
+    publisher.join();
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_wait_set(wait_set));
+  }
+
+  static void report(const char * mode, std::vector<int64_t> latencies)
+  {
+    ASSERT_FALSE(latencies.empty());
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return latencies[static_cast<size_t>(p * (latencies.size() - 1))] / 1000.0;
+      };
+    printf(
+      "%-10s p50 %8.2f us  p90 %8.2f us  p99 %8.2f us  max %8.2f us\n", mode,
+      percentile(0.5), percentile(0.9), percentile(0.99), percentile(1.0));
+  }
+
+  rmw_context_t context;
+  rmw_node_t * node;
+  rmw_publisher_t * pub;
+  rmw_subscription_t * sub;
+};
+
+// Latency from rmw_publish to rmw_wait returning, with the waiter blocking in epoll right away,
+// and with it spinning on the message queue first
+TEST_F(WaitLatencyBenchmark, blocking_vs_spinning) {
+  std::vector<int64_t> blocking, spinning;
+  measure(0, blocking);
+  ASSERT_EQ(kSamples, blocking.size());
+  measure(kSpinNs, spinning);
+  ASSERT_EQ(kSamples, spinning.size());
+
+  report("blocking", blocking);
+  report("spinning", spinning);
+}